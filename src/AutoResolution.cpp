@@ -0,0 +1,169 @@
+#include "AutoResolution.h"
+#include <cmath>
+
+namespace
+{
+    // Upper limits on the samples chosen for one knot span and one direction,
+    // reached when the bounds are huge or the targets tiny.
+    const index_t MAX_SPAN_SAMPLES = 4096;
+    const index_t MAX_DIRECTION_SAMPLES = index_t(1) << 20;
+
+    // Largest first and second derivative norm along direction d on every knot
+    // span. The derivative of a B-spline is a B-spline of one degree lower whose
+    // control points are the scaled differences of the original ones, and on a
+    // span it lies in the convex hull of its active control points.
+    void DerivativeBounds(const gismo::gsKnotVector<> &knots, int degree, const gsMatrix<> &coefs,
+                          const std::vector<index_t> &sizes, int d,
+                          std::vector<real_t> &firstBound, std::vector<real_t> &secondBound)
+    {
+        const index_t n = sizes[d];
+        index_t stride = 1;
+        for(int e = 0; e < d; e++) {
+            stride *= sizes[e];
+        }
+        firstBound.assign(knots.size(), 0);
+        secondBound.assign(knots.size(), 0);
+        if(degree < 1 || n < 2) {
+            return;
+        }
+
+        gsMatrix<> first(n - 1, coefs.cols()), second(std::max<index_t>(n - 2, 0), coefs.cols());
+        // Control points are stored with the first direction running fastest.
+        for(index_t r = 0; r < coefs.rows() / n; r++) {
+            const index_t base = r % stride + (r / stride) * stride * n;
+            for(index_t i = 0; i + 1 < n; i++) {
+                const real_t span = knots[i + degree + 1] - knots[i + 1];
+                first.row(i).setZero();
+                if(span > 0) {
+                    first.row(i) = degree / span * (coefs.row(base + (i + 1) * stride) - coefs.row(base + i * stride));
+                }
+            }
+            for(index_t i = 0; i + 2 < n && degree > 1; i++) {
+                const real_t span = knots[i + degree + 1] - knots[i + 2];
+                second.row(i).setZero();
+                if(span > 0) {
+                    second.row(i) = (degree - 1) / span * (first.row(i + 1) - first.row(i));
+                }
+            }
+            for(index_t s = degree; s < n; s++) {
+                for(index_t i = s - degree; i < s; i++) {
+                    firstBound[s] = std::max(firstBound[s], first.row(i).norm());
+                }
+                for(index_t i = s - degree; i + 1 < s && degree > 1; i++) {
+                    secondBound[s] = std::max(secondBound[s], second.row(i).norm());
+                }
+            }
+        }
+    }
+}
+
+bool AutoResolution::ComputeGridLines(const gismo::gsGeometry<> &geometry, real_t edgeLength, real_t chordTolerance,
+                                      std::vector<std::vector<real_t>> &gridLines)
+{
+    if(edgeLength <= 0 && chordTolerance <= 0) {
+        gsInfo << "Automatic resolution needs a target edge length or chord tolerance.\n";
+        return false;
+    }
+    // A NURBS basis wraps a tensor B-spline basis. Its derivatives are not bounded
+    // by the control net alone, so the bounds are scaled by the weight ratio.
+    const bool rational = geometry.basis().isRational();
+    const gismo::gsBasis<> &basis = rational ? geometry.basis().source() : geometry.basis();
+    real_t weightRatio = 1;
+    if(rational) {
+        const gsMatrix<> &weights = geometry.basis().weights();
+        if(weights.minCoeff() <= 0) {
+            gsInfo << "Automatic resolution needs positive NURBS weights.\n";
+            return false;
+        }
+        weightRatio = weights.maxCoeff() / weights.minCoeff();
+    }
+
+    const int parDim = geometry.parDim();
+    std::vector<const gismo::gsBSplineBasis<> *> components(parDim);
+    std::vector<index_t> sizes(parDim);
+    index_t numCoefs = 1;
+    for(int d = 0; d < parDim; d++) {
+        components[d] = dynamic_cast<const gismo::gsBSplineBasis<> *>(&basis.component(d));
+        if(!components[d]) {
+            gsInfo << "Automatic resolution only supports tensor B-spline and NURBS geometries.\n";
+            return false;
+        }
+        sizes[d] = components[d]->size();
+        numCoefs *= sizes[d];
+    }
+    if(numCoefs != geometry.coefs().rows()) {
+        gsInfo << "Control net does not match the tensor basis.\n";
+        return false;
+    }
+
+    gridLines.assign(parDim, std::vector<real_t>());
+    std::vector<real_t> firstBound, secondBound;
+    std::vector<index_t> counts;
+    for(int d = 0; d < parDim; d++) {
+        const gismo::gsKnotVector<> &knots = components[d]->knots();
+        const int degree = components[d]->degree();
+        DerivativeBounds(knots, degree, geometry.coefs(), sizes, d, firstBound, secondBound);
+
+        // On a span of parameter step h, an edge is at most h * |C'| long and the
+        // chord deviates at most h^2 / 8 * |C''| from the curve.
+        counts.assign(sizes[d], 0);
+        int64_t total = 0;
+        index_t numClamped = 0;
+        for(index_t s = degree; s < sizes[d]; s++) {
+            const real_t length = knots[s + 1] - knots[s];
+            if(length <= 0) {
+                continue;
+            }
+            real_t step = length;
+            const real_t first = weightRatio * firstBound[s];
+            const real_t second = weightRatio * weightRatio * secondBound[s];
+            if(edgeLength > 0 && first > 0) {
+                step = std::min(step, edgeLength / first);
+            }
+            if(chordTolerance > 0 && second > 0) {
+                step = std::min(step, std::sqrt(8 * chordTolerance / second));
+            }
+            // Compare in floating point, the ratio can be far beyond index_t.
+            const real_t count = std::ceil(length / step);
+            if(!(count <= MAX_SPAN_SAMPLES)) {
+                numClamped++;
+            }
+            counts[s] = count <= MAX_SPAN_SAMPLES ? std::max<index_t>(1, static_cast<index_t>(count)) : MAX_SPAN_SAMPLES;
+            total += counts[s];
+        }
+        if(numClamped > 0) {
+            gsInfo << "Warning: " << numClamped << " knot spans in direction " << d << " need more than "
+                   << MAX_SPAN_SAMPLES << " samples, clamped to " << MAX_SPAN_SAMPLES << ".\n";
+        }
+        if(total > MAX_DIRECTION_SAMPLES) {
+            // Every span keeps at least one sample, so report the total actually reached.
+            int64_t scaled = 0;
+            for(index_t &count : counts) {
+                if(count > 0) {
+                    count = std::max<index_t>(1, static_cast<index_t>(static_cast<real_t>(count) * MAX_DIRECTION_SAMPLES / total));
+                    scaled += count;
+                }
+            }
+            gsInfo << "Warning: direction " << d << " needs " << total << " samples, scaled down to "
+                   << scaled << ".\n";
+        }
+
+        gridLines[d].assign(1, knots[degree]);
+        for(index_t s = degree; s < sizes[d]; s++) {
+            if(counts[s] == 0) {
+                continue;
+            }
+            const real_t length = knots[s + 1] - knots[s];
+            for(index_t k = 1; k < counts[s]; k++) {
+                gridLines[d].push_back(knots[s] + k * length / counts[s]);
+            }
+            gridLines[d].push_back(knots[s + 1]);
+        }
+    }
+    gsInfo << "Automatic resolution:";
+    for(int d = 0; d < parDim; d++) {
+        gsInfo << (d == 0 ? " " : " x ") << gridLines[d].size() - 1;
+    }
+    gsInfo << " cells.\n";
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <gismo.h>
+
+// Chooses the sampling of a tensor B-spline or NURBS geometry before any
+// tessellation, from its knot vectors, degrees and control net. Every knot
+// span gets its own sample count, derived from bounds on the first and second
+// derivative along each parameter direction.
+class AutoResolution
+{
+public:
+    // Fill gridLines with the parameter values per direction so that mesh edges
+    // along the parameter lines are at most edgeLength long and deviate at most
+    // chordTolerance from the spline. A value <= 0 disables that criterion.
+    static bool ComputeGridLines(const gismo::gsGeometry<> &geometry, real_t edgeLength, real_t chordTolerance,
+                                 std::vector<std::vector<real_t>> &gridLines);
+};
@@ -0,0 +1,75 @@
+#include "ExportUtils.h"
+#include <thread>
+
+int ExportUtils::NumThreads(int numThreads)
+{
+    return numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool ExportUtils::IsLittleEndian()
+{
+    const uint16_t endianTest = 1;
+    return *reinterpret_cast<const uint8_t *>(&endianTest) == 1;
+}
+
+void ExportUtils::WriteOffHeader(std::ostream &out, int64_t numVertices, int64_t numFaces)
+{
+    out << "OFF\n";
+    out << numVertices << " " << numFaces << " 0\n";
+}
+
+void ExportUtils::WritePlyHeader(std::ostream &out, const std::string &format, const std::vector<std::string> &comments,
+                                 int64_t numVertices, const std::vector<std::string> &vertexProperties,
+                                 int64_t numFaces, bool withColor)
+{
+    out << "ply\n";
+    out << "format " << format << " 1.0\n";
+    for(const auto &comment : comments) {
+        out << "comment " << comment << "\n";
+    }
+    out << "element vertex " << numVertices << "\n";
+    for(const auto &property : vertexProperties) {
+        out << "property " << property << "\n";
+    }
+    out << "element face " << numFaces << "\n";
+    out << "property list uchar int vertex_indices\n";
+    if(withColor) {
+        out << "property uchar red\n";
+        out << "property uchar green\n";
+        out << "property uchar blue\n";
+    }
+    out << "end_header\n";
+}
+
+void ExportUtils::WriteObjHeader(std::ostream &out, const std::string &filename, int64_t numVertices, int64_t numFaces)
+{
+    out << "###\n";
+    out << "#\n";
+    out << "# OBJ File " << filename << '\n';
+    out << "# Exported by Spline_to_mesh\n";
+    out << "#\n";
+    out << "# Vertices: " << numVertices << '\n';
+    out << "# Faces: " << numFaces << '\n';
+    out << "#\n";
+    out << "###\n";
+    out << "mtllib ./" << filename + ".mtl" << "\n\n";
+}
+
+void ExportUtils::WriteMaterials(std::ostream &out, const std::vector<std::array<index_t, 3>> &colors, index_t numMaterials)
+{
+    out << "#\n";
+    out << "# Material definitions\n";
+    out << "# Exported by Spline_to_mesh\n";
+    out << "#\n\n";
+    out << std::fixed << std::setprecision(6);
+    for(index_t i = 0; i < numMaterials; ++i) {
+        const auto &color = colors[i % colors.size()];
+        out << "newmtl material_" << i << '\n';
+        out << "Ka " << 0.2 << " " << 0.2 << " " << 0.2 << '\n';
+        out << "Kd " << color[0] / 255.0 << " " << color[1] / 255.0 << " " << color[2] / 255.0 << '\n';
+        out << "Ks " << 1.0 << ' ' << 1.0 << ' ' << 1.0 << '\n';
+        out << "Tr " << 0.0 << '\n';
+        out << "illum 2\n";
+        out << "Ns " << 0.0 << "\n\n";
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <gismo.h>
+
+// File headers and material definitions written both by the in-memory mesh
+// exporters and by the tiled builder, so that the two paths stay identical,
+// plus the small helpers every writer needs.
+class ExportUtils
+{
+public:
+    // Number of threads to use for a requested count, 0 for the hardware concurrency.
+    static int NumThreads(int numThreads);
+    // Byte order of the binary outputs, which are written in native order.
+    static bool IsLittleEndian();
+
+    static void WriteOffHeader(std::ostream &out, int64_t numVertices, int64_t numFaces);
+    // PLY header for the given format ("ascii", "binary_little_endian", ...).
+    // vertexProperties are "type name" entries, faces have an optional color.
+    static void WritePlyHeader(std::ostream &out, const std::string &format, const std::vector<std::string> &comments,
+                               int64_t numVertices, const std::vector<std::string> &vertexProperties,
+                               int64_t numFaces, bool withColor);
+    // Banner and material library reference of an OBJ file with colors.
+    static void WriteObjHeader(std::ostream &out, const std::string &filename, int64_t numVertices, int64_t numFaces);
+    // One material_i per color index i < numMaterials.
+    static void WriteMaterials(std::ostream &out, const std::vector<std::array<index_t, 3>> &colors, index_t numMaterials);
+};
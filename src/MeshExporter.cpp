@@ -1,48 +1,179 @@
 #include "MeshExporter.h"
+#include "ExportUtils.h"
+#include <deque>
 #include <fstream>
+#include <future>
+#include <sstream>
+
+template<class T>
+bool BasisMeshExporter<T>::WriteChunked(std::ostream &out, size_t count,
+                                     const std::function<void(std::ostream &, size_t, size_t)> &format) const
+{
+    const size_t chunkSize = size_t(1) << 16;
+    const size_t numThreads = ExportUtils::NumThreads(_numThreads);
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    // Every pending chunk runs on its own thread, so at most numThreads chunks are
+    // in flight while the oldest one is written.
+    std::deque<std::future<std::string>> pending;
+    size_t next = 0;
+    while(next < count || !pending.empty()) {
+        while(next < count && pending.size() < numThreads) {
+            const size_t begin = next, end = std::min(next + chunkSize, count);
+            pending.push_back(std::async(std::launch::async, [&format, flags, precision, begin, end]() {
+                std::ostringstream chunk;
+                chunk.flags(flags);
+                chunk.precision(precision);
+                format(chunk, begin, end);
+                return chunk.str();
+            }));
+            next = end;
+        }
+        const std::string buffer = pending.front().get();
+        pending.pop_front();
+        out.write(buffer.data(), buffer.size());
+        if(!out) {
+            // Format no further chunks, the ones in flight are waited for on return.
+            return false;
+        }
+    }
+    return true;
+}
+
+template<class T>
+bool BasisMeshExporter<T>::CloseFile(std::fstream &out, const std::string &filename)
+{
+    out.close();
+    if(!out) {
+        _error = "Failed to write file: " + filename;
+        return false;
+    }
+    return true;
+}
 
 #ifdef ASSIMP_USE
-void AssimpMeshExporter::ExportMeshtoScene(const gismo::gsMesh<> &mesh,
-                         const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+template<class T>
+void AssimpMeshExporter<T>::ExportMeshtoScene(const gismo::gsMesh<T> &mesh,
+                         const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                          aiScene &scene)
 {
-    scene.mRootNode = new aiNode();
-    // Create mesh
-    scene.mMeshes = new aiMesh*[1];
-    scene.mMeshes[0] = new aiMesh();
-    aiMesh* meshPtr = scene.mMeshes[0];
-    meshPtr->mNumVertices = mesh.numVertices();
-    meshPtr->mVertices = new aiVector3D[mesh.numVertices()];
-    for(int i = 0; i < mesh.numVertices(); ++i) {
-        const auto& vertex = mesh.vertex(i);
-        meshPtr->mVertices[i] = aiVector3D(vertex[0], vertex[1], vertex[2]);
+    const size_t numVertices = mesh.numVertices();
+    const bool withNormals = HasNormals(mesh);
+
+    // Split faces by color index, one aiMesh and one material per patch.
+    index_t numPatches = 1;
+    for(const auto &item : faceIndexMap) {
+        numPatches = std::max(numPatches, item.second + 1);
+    }
+    std::vector<std::vector<index_t>> patchFaces(numPatches);
+    size_t numIndices = 0;
+    for(const auto &face : mesh.faces()) {
+        auto it = faceIndexMap.find(face);
+        patchFaces[it != faceIndexMap.end() ? it->second : 0].push_back(face->getId());
+        numIndices += face->vertices.size();
     }
-    meshPtr->mNumFaces = mesh.numFaces();
-    meshPtr->mFaces = new aiFace[mesh.numFaces()];
-    for(int i = 0; i < mesh.numFaces(); ++i) {
-        const auto& face = mesh.face(i);
-        meshPtr->mFaces[i].mNumIndices = face->vertices.size();
-        meshPtr->mFaces[i].mIndices = new unsigned int[face->vertices.size()];
-        for(size_t j = 0; j < face->vertices.size(); ++j) {
-            meshPtr->mFaces[i].mIndices[j] = face->vertices[j]->getId();
+    _indexPool.resize(numIndices);
+
+    std::vector<unsigned int> patchIds;
+    for(index_t p = 0; p < numPatches; ++p) {
+        if(!patchFaces[p].empty()) {
+            patchIds.push_back(p);
         }
     }
+    scene.mNumMeshes = patchIds.size();
+    scene.mMeshes = new aiMesh*[scene.mNumMeshes];
+    scene.mNumMaterials = patchIds.size();
+    scene.mMaterials = new aiMaterial*[scene.mNumMaterials];
+    scene.mRootNode = new aiNode();
+    scene.mRootNode->mNumMeshes = scene.mNumMeshes;
+    scene.mRootNode->mMeshes = new unsigned int[scene.mNumMeshes];
+
+    // A single patch keeps the mesh vertex order, several patches renumber their
+    // vertices in order of first use.
+    const bool singlePatch = patchIds.size() == 1;
+    std::vector<int> localIndex(singlePatch ? 0 : numVertices, -1);
+    std::vector<index_t> usedVertices;
+    auto vertexIndex = [&](index_t id) { return singlePatch ? id : localIndex[id]; };
+    unsigned int *indexPtr = _indexPool.data();
+    for(unsigned int m = 0; m < patchIds.size(); ++m) {
+        const auto &faceIds = patchFaces[patchIds[m]];
+        usedVertices.clear();
+        for(size_t k = 0; k < faceIds.size() && !singlePatch; ++k) {
+            for(const auto &v : mesh.faces()[faceIds[k]]->vertices) {
+                if(localIndex[v->getId()] < 0) {
+                    localIndex[v->getId()] = usedVertices.size();
+                    usedVertices.push_back(v->getId());
+                }
+            }
+        }
+        const size_t patchVertices = singlePatch ? numVertices : usedVertices.size();
 
-    // Create material (even if not needed, an empty material is required for some formats)
-    scene.mMaterials = new aiMaterial*[1];
-    scene.mMaterials[0] = new aiMaterial();
-    scene.mNumMaterials = 1;
+        aiMesh *meshPtr = new aiMesh();
+        scene.mMeshes[m] = meshPtr;
+        scene.mRootNode->mMeshes[m] = m;
+        meshPtr->mName = aiString("patch_" + std::to_string(patchIds[m]));
+        meshPtr->mMaterialIndex = m;
+        meshPtr->mNumVertices = patchVertices;
+        meshPtr->mVertices = new aiVector3D[patchVertices];
+        if(withNormals) {
+            meshPtr->mNormals = new aiVector3D[patchVertices];
+        }
+        // Write straight from the mesh into the aiMesh arrays.
+        for(size_t i = 0; i < patchVertices; ++i) {
+            const index_t id = singlePatch ? i : usedVertices[i];
+            const auto &vertex = *mesh.vertices()[id];
+            meshPtr->mVertices[i] = aiVector3D(vertex.x(), vertex.y(), vertex.z());
+            if(withNormals) {
+                meshPtr->mNormals[i] = aiVector3D((*_normals)(0, id), (*_normals)(1, id), (*_normals)(2, id));
+            }
+        }
 
-    meshPtr->mMaterialIndex = 0;
+        meshPtr->mNumFaces = faceIds.size();
+        meshPtr->mFaces = new aiFace[faceIds.size()];
+        meshPtr->mPrimitiveTypes = 0;
+        for(size_t i = 0; i < faceIds.size(); ++i) {
+            const auto &vertices = mesh.faces()[faceIds[i]]->vertices;
+            aiFace &face = meshPtr->mFaces[i];
+            face.mNumIndices = vertices.size();
+            face.mIndices = indexPtr;
+            for(const auto &v : vertices) {
+                *indexPtr++ = vertexIndex(v->getId());
+            }
+            meshPtr->mPrimitiveTypes |= vertices.size() == 3 ? aiPrimitiveType_TRIANGLE : aiPrimitiveType_POLYGON;
+        }
+        for(index_t v : usedVertices) {
+            localIndex[v] = -1;
+        }
 
-    scene.mNumMeshes = 1;
-    scene.mRootNode->mMeshes = new unsigned int[1];
-    scene.mRootNode->mMeshes[0] = 0;
-    scene.mRootNode->mNumMeshes = 1;
+        // Create material (even if not needed, an empty material is required for some formats)
+        aiMaterial *material = new aiMaterial();
+        aiString name("material_" + std::to_string(patchIds[m]));
+        material->AddProperty(&name, AI_MATKEY_NAME);
+        if(_optionFlag & WITH_COLOR) {
+            const auto &color = _colors[patchIds[m] % _colors.size()];
+            aiColor3D diffuse(color[0] / 255.0f, color[1] / 255.0f, color[2] / 255.0f);
+            material->AddProperty(&diffuse, 1, AI_MATKEY_COLOR_DIFFUSE);
+        }
+        scene.mMaterials[m] = material;
+    }
 }
 
-bool AssimpMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
-                                   const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+template<class T>
+void AssimpMeshExporter<T>::ReleaseIndexPool(aiScene &scene)
+{
+    // aiFace deletes its indices on destruction, detach them from the pool first.
+    for(unsigned int m = 0; m < scene.mNumMeshes; ++m) {
+        for(unsigned int i = 0; i < scene.mMeshes[m]->mNumFaces; ++i) {
+            scene.mMeshes[m]->mFaces[i].mIndices = nullptr;
+        }
+    }
+    _indexPool.clear();
+    _indexPool.shrink_to_fit();
+}
+
+template<class T>
+bool AssimpMeshExporter<T>::ExportMesh(const gismo::gsMesh<T> &mesh,
+                                   const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                                    const std::string &format,
                                    const std::string &filename)
 {
@@ -52,103 +183,115 @@ bool AssimpMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
 
     Assimp::Exporter exporter;
     aiReturn ret = exporter.Export(&scene, format.c_str(), filename.c_str());
+    ReleaseIndexPool(scene);
     
     if (ret != AI_SUCCESS) {
-        std::cerr << "Assimp export error: " << exporter.GetErrorString() << '\n';
+        _error = std::string("Assimp export error: ") + exporter.GetErrorString();
         return false;
     }
     return true;
 }
 #endif
 
-bool OffMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
-                                 const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+template<class T>
+bool OffMeshExporter<T>::ExportMesh(const gismo::gsMesh<T> &mesh,
+                                 const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                                  const std::string &format,
                                  const std::string &filename)
 {
     std::fstream fileOut(filename, std::ios::out);
     if (!fileOut.is_open()) {
-        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        _error = "Failed to open file for writing: " + filename;
         return false;
     }   
-    fileOut << "OFF\n";
-    fileOut << mesh.numVertices() << " " << mesh.numFaces() << " 0\n";
-    fileOut << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
-    for (const auto& vertex : mesh.vertices()) {
-        fileOut << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
-    }
-    for (const auto& face : mesh.faces()) {
-        fileOut << face->vertices.size();
-        for (const auto& v : face->vertices) {
-            fileOut << " " << v->getId();
+    ExportUtils::WriteOffHeader(fileOut, mesh.numVertices(), mesh.numFaces());
+    SetTextFormat(fileOut);
+    if (!WriteChunked(fileOut, mesh.numVertices(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& vertex = mesh.vertices()[i];
+            os << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
         }
-        if (_optionFlag & WITH_COLOR) {
-            index_t colorIndex = faceIndexMap.at(face);
-            fileOut << " " << _colors[colorIndex][0]
-                    << " " << _colors[colorIndex][1]
-                    << " " << _colors[colorIndex][2];
-        }
-        fileOut << '\n';
+    })) {
+        return CloseFile(fileOut, filename);
     }
+    WriteChunked(fileOut, mesh.numFaces(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& face = mesh.faces()[i];
+            os << face->vertices.size();
+            for (const auto& v : face->vertices) {
+                os << " " << v->getId();
+            }
+            if (_optionFlag & WITH_COLOR) {
+                index_t colorIndex = faceIndexMap.at(face);
+                os << " " << _colors[colorIndex][0]
+                   << " " << _colors[colorIndex][1]
+                   << " " << _colors[colorIndex][2];
+            }
+            os << '\n';
+        }
+    });
     
-    fileOut.close();
-    return true;
+    return CloseFile(fileOut, filename);
 }
 
-bool ObjMeshExporter::ExportMeshOnly(const gismo::gsMesh<> &mesh,
+template<class T>
+bool ObjMeshExporter<T>::ExportMeshOnly(const gismo::gsMesh<T> &mesh,
                                      const std::string &filename)
 {
     std::fstream fileOut(filename, std::ios::out);
     if (!fileOut.is_open()) {
-        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        _error = "Failed to open file for writing: " + filename;
         return false;
     }
 
-    fileOut << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
-    for (const auto& vertex : mesh.vertices()) {
-        fileOut << "v " << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
+    SetTextFormat(fileOut);
+    if (!WriteChunked(fileOut, mesh.numVertices(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& vertex = mesh.vertices()[i];
+            os << "v " << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
+        }
+    })) {
+        return CloseFile(fileOut, filename);
     }
     
-    for (const auto& face : mesh.faces()) {
-        fileOut << "f";
-        for (const auto& v : face->vertices) {
-            fileOut << " " << v->getId() + 1; // OBJ format is 1-indexed
+    WriteChunked(fileOut, mesh.numFaces(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            os << "f";
+            for (const auto& v : mesh.faces()[i]->vertices) {
+                os << " " << v->getId() + 1; // OBJ format is 1-indexed
+            }
+            os << '\n';
         }
-        fileOut << '\n';
-    }
-    fileOut.close();
-    return true;
+    });
+    return CloseFile(fileOut, filename);
 }
 
-bool ObjMeshExporter::ExportMeshWithColor(const gismo::gsMesh<> &mesh,
-                                          const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+template<class T>
+bool ObjMeshExporter<T>::ExportMeshWithColor(const gismo::gsMesh<T> &mesh,
+                                          const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                                           const std::string &filename)
 {
     std::fstream fileOut(filename, std::ios::out);
     if (!fileOut.is_open()) {
-        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        _error = "Failed to open file for writing: " + filename;
         return false;
     }
     std::fstream fileMatOut(filename + ".mtl", std::ios::out);
     if (!fileMatOut.is_open()) {
-        std::cerr << "Failed to open material file for writing: " << filename + ".mtl\n";
+        _error = "Failed to open material file for writing: " + filename + ".mtl";
         return false;
     }
 
-    fileOut << "###\n";
-    fileOut << "#\n";
-    fileOut << "# OBJ File " << filename << '\n';
-    fileOut << "# Exported by Spline_to_mesh\n";
-    fileOut << "#\n";
-    fileOut << "# Vertices: " << mesh.numVertices() << '\n';
-    fileOut << "# Faces: " << mesh.numFaces() << '\n';
-    fileOut << "#\n";
-    fileOut << "###\n";
-    fileOut << "mtllib ./" << filename + ".mtl" << "\n\n";
+    ExportUtils::WriteObjHeader(fileOut, filename, mesh.numVertices(), mesh.numFaces());
 
-    fileOut << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
-    for (const auto& vertex : mesh.vertices()) {
-        fileOut << "v " << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
+    SetTextFormat(fileOut);
+    if (!WriteChunked(fileOut, mesh.numVertices(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& vertex = mesh.vertices()[i];
+            os << "v " << vertex->x() << " " << vertex->y() << " " << vertex->z() << '\n';
+        }
+    })) {
+        return CloseFile(fileOut, filename);
     }
     fileOut << "\n\n";
     
@@ -167,41 +310,29 @@ bool ObjMeshExporter::ExportMeshWithColor(const gismo::gsMesh<> &mesh,
     // Write faces with colors
     for (index_t i = 0; i < colorNum; ++i) {
         fileOut << "usemtl material_" << i << '\n';
-        for (const auto& faceId : facesWithColor[i]) {
-            fileOut << "f";
-            const auto& face = mesh.face(faceId);
-            for (const auto& v : face->vertices) {
-                fileOut << " " << v->getId() + 1; // OBJ format is 1-indexed
+        const auto& faceIds = facesWithColor[i];
+        if (!WriteChunked(fileOut, faceIds.size(), [&](std::ostream &os, size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                os << "f";
+                for (const auto& v : mesh.faces()[faceIds[k]]->vertices) {
+                    os << " " << v->getId() + 1; // OBJ format is 1-indexed
+                }
+                os << '\n';
             }
-            fileOut << '\n';
+        })) {
+            return CloseFile(fileOut, filename);
         }
         fileOut << '\n';
     }
     // Write material definitions
-    fileMatOut << "#\n";
-    fileMatOut << "# Material definitions\n";
-    fileMatOut << "# Exported by Spline_to_mesh\n";
-    fileMatOut << "#\n\n";
-    fileMatOut << std::fixed << std::setprecision(6);
-    for(index_t i = 0; i < colorNum; ++i) {
-        fileMatOut << "newmtl material_" << i << '\n';
-        fileMatOut << "Ka " << 0.2 << " " << 0.2 << " " << 0.2 << '\n';
-        fileMatOut << "Kd " << _colors[i][0] / 255.0 << " "
-                   << _colors[i][1] / 255.0 << " "
-                   << _colors[i][2] / 255.0 << '\n';
-        fileMatOut << "Ks " << 1.0 << ' ' << 1.0 << ' ' << 1.0 << '\n';
-        fileMatOut << "Tr " << 0.0 << '\n';
-        fileMatOut << "illum 2\n";
-        fileMatOut << "Ns " << 0.0 << "\n\n";
-    }
+    ExportUtils::WriteMaterials(fileMatOut, _colors, colorNum);
 
-    fileOut.close();
-    fileMatOut.close();
-    return true;
+    return CloseFile(fileMatOut, filename + ".mtl") && CloseFile(fileOut, filename);
 }
 
-bool ObjMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
-                                 const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+template<class T>
+bool ObjMeshExporter<T>::ExportMesh(const gismo::gsMesh<T> &mesh,
+                                 const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                                  const std::string &format,
                                  const std::string &filename)
 {
@@ -212,54 +343,181 @@ bool ObjMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
     }
 }
 
-bool PlyMeshExporter::ExportMesh(const gismo::gsMesh<> &mesh,
-                                 const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+namespace
+{
+    template<class T>
+    void WriteBinary(std::ostream &os, T value)
+    {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // Octahedral encoding of a unit normal into two snorm16 values.
+    std::array<int16_t, 2> EncodeOctahedral(real_t x, real_t y, real_t z)
+    {
+        const real_t l1 = std::abs(x) + std::abs(y) + std::abs(z);
+        real_t u = l1 > 0 ? x / l1 : 0, v = l1 > 0 ? y / l1 : 0;
+        if(z < 0) {
+            const real_t pu = u, pv = v;
+            u = (1 - std::abs(pv)) * (pu >= 0 ? 1 : -1);
+            v = (1 - std::abs(pu)) * (pv >= 0 ? 1 : -1);
+        }
+        auto snorm = [](real_t a) {
+            return static_cast<int16_t>(std::lround(std::min<real_t>(std::max<real_t>(a, -1), 1) * 32767));
+        };
+        return {snorm(u), snorm(v)};
+    }
+}
+
+template<class T>
+bool PlyMeshExporter<T>::ExportBinary(const gismo::gsMesh<T> &mesh,
+                                   const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
+                                   const std::string &filename)
+{
+    std::fstream fileOut(filename, std::ios::out | std::ios::binary);
+    if (!fileOut.is_open()) {
+        _error = "Failed to open file for writing: " + filename;
+        return false;
+    }
+    const bool quantize = _optionFlag & QUANTIZE;
+    const bool withNormals = HasNormals(mesh);
+    const bool littleEndian = ExportUtils::IsLittleEndian();
+
+    // Bounding box used to quantize positions to the full 16-bit range.
+    gsVector3d<real_t> boxMin, boxScale;
+    boxMin.setConstant(std::numeric_limits<real_t>::max());
+    gsVector3d<real_t> boxMax = -boxMin;
+    for (const auto& vertex : mesh.vertices()) {
+        boxMin = boxMin.cwiseMin(vertex->template cast<real_t>());
+        boxMax = boxMax.cwiseMax(vertex->template cast<real_t>());
+    }
+    for (int d = 0; d < 3; ++d) {
+        boxScale[d] = boxMax[d] > boxMin[d] ? 65535 / (boxMax[d] - boxMin[d]) : 0;
+    }
+
+    std::vector<std::string> comments;
+    if (quantize) {
+        std::ostringstream bboxMin, bboxMax;
+        bboxMin << std::setprecision(std::numeric_limits<real_t>::max_digits10)
+                << "bbox_min " << boxMin[0] << " " << boxMin[1] << " " << boxMin[2];
+        bboxMax << std::setprecision(std::numeric_limits<real_t>::max_digits10)
+                << "bbox_max " << boxMax[0] << " " << boxMax[1] << " " << boxMax[2];
+        comments = {"position = bbox_min + (x, y, z) / 65535 * (bbox_max - bbox_min)", bboxMin.str(), bboxMax.str()};
+        if (withNormals) {
+            comments.push_back("normal octahedral snorm16 (nu, nv)");
+        }
+    }
+    const std::string positionType = quantize ? "ushort" : "float";
+    std::vector<std::string> vertexProperties = {positionType + " x", positionType + " y", positionType + " z"};
+    if (withNormals && quantize) {
+        vertexProperties.insert(vertexProperties.end(), {"short nu", "short nv"});
+    } else if (withNormals) {
+        vertexProperties.insert(vertexProperties.end(), {"float nx", "float ny", "float nz"});
+    }
+    ExportUtils::WritePlyHeader(fileOut, littleEndian ? "binary_little_endian" : "binary_big_endian", comments,
+                                mesh.numVertices(), vertexProperties, mesh.numFaces(), _optionFlag & WITH_COLOR);
+
+    if (!WriteChunked(fileOut, mesh.numVertices(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& vertex = *mesh.vertices()[i];
+            for (int d = 0; d < 3; ++d) {
+                if (quantize) {
+                    WriteBinary<uint16_t>(os, static_cast<uint16_t>(std::lround((vertex[d] - boxMin[d]) * boxScale[d])));
+                } else {
+                    WriteBinary<float>(os, static_cast<float>(vertex[d]));
+                }
+            }
+            if (withNormals && quantize) {
+                const auto oct = EncodeOctahedral((*_normals)(0, i), (*_normals)(1, i), (*_normals)(2, i));
+                WriteBinary<int16_t>(os, oct[0]);
+                WriteBinary<int16_t>(os, oct[1]);
+            } else if (withNormals) {
+                for (int d = 0; d < 3; ++d) {
+                    WriteBinary<float>(os, static_cast<float>((*_normals)(d, i)));
+                }
+            }
+        }
+    })) {
+        return CloseFile(fileOut, filename);
+    }
+    WriteChunked(fileOut, mesh.numFaces(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& face = mesh.faces()[i];
+            WriteBinary<uint8_t>(os, static_cast<uint8_t>(face->vertices.size()));
+            for (const auto& v : face->vertices) {
+                WriteBinary<int32_t>(os, v->getId());
+            }
+            if (_optionFlag & WITH_COLOR) {
+                index_t colorIndex = faceIndexMap.at(face);
+                for (int c = 0; c < 3; ++c) {
+                    WriteBinary<uint8_t>(os, static_cast<uint8_t>(_colors[colorIndex][c]));
+                }
+            }
+        }
+    });
+    return CloseFile(fileOut, filename);
+}
+
+template<class T>
+bool PlyMeshExporter<T>::ExportMesh(const gismo::gsMesh<T> &mesh,
+                                 const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                                  const std::string &format,
                                  const std::string &filename)
 {
+    if (_optionFlag & BINARY_OUTPUT) {
+        return ExportBinary(mesh, faceIndexMap, filename);
+    }
     std::fstream fileOut(filename, std::ios::out);
     if (!fileOut.is_open()) {
-        std::cerr << "Failed to open file for writing: " << filename << "\n";
+        _error = "Failed to open file for writing: " + filename;
         return false;
     }
     
-    fileOut << "ply\n";
-    fileOut << "format ascii 1.0\n";
-    fileOut << "element vertex " << mesh.numVertices() << "\n";
-    fileOut << "property float x\n";
-    fileOut << "property float y\n";
-    fileOut << "property float z\n";
-    fileOut << "element face " << mesh.numFaces() << "\n";
-    fileOut << "property list uchar int vertex_indices\n";
-    
-    if (_optionFlag & WITH_COLOR) {
-        fileOut << "property uchar red\n";
-        fileOut << "property uchar green\n";
-        fileOut << "property uchar blue\n";
-    }
-    
-    fileOut << "end_header\n";
+    ExportUtils::WritePlyHeader(fileOut, "ascii", {}, mesh.numVertices(), {"float x", "float y", "float z"},
+                                mesh.numFaces(), _optionFlag & WITH_COLOR);
 
-    fileOut << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
-    for (const auto& vertex : mesh.vertices()) {
-        fileOut << vertex->x() << " " << vertex->y() << " " << vertex->z();
-        fileOut << '\n';
+    SetTextFormat(fileOut);
+    if (!WriteChunked(fileOut, mesh.numVertices(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& vertex = mesh.vertices()[i];
+            os << vertex->x() << " " << vertex->y() << " " << vertex->z();
+            os << '\n';
+        }
+    })) {
+        return CloseFile(fileOut, filename);
     }
 
-    for (const auto& face : mesh.faces()) {
-        fileOut << face->vertices.size();
-        for (const auto& v : face->vertices) {
-            fileOut << " " << v->getId();
-        }
-        if (_optionFlag & WITH_COLOR) {
-            index_t colorIndex = faceIndexMap.at(face);
-            fileOut << " "
-                    << static_cast<int>(_colors[colorIndex][0]) << " "
-                    << static_cast<int>(_colors[colorIndex][1]) << " "
-                    << static_cast<int>(_colors[colorIndex][2]);
+    WriteChunked(fileOut, mesh.numFaces(), [&](std::ostream &os, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& face = mesh.faces()[i];
+            os << face->vertices.size();
+            for (const auto& v : face->vertices) {
+                os << " " << v->getId();
+            }
+            if (_optionFlag & WITH_COLOR) {
+                index_t colorIndex = faceIndexMap.at(face);
+                os << " "
+                   << static_cast<int>(_colors[colorIndex][0]) << " "
+                   << static_cast<int>(_colors[colorIndex][1]) << " "
+                   << static_cast<int>(_colors[colorIndex][2]);
+            }
+            os << '\n';
         }
-        fileOut << '\n';
-    }
-    fileOut.close();
-    return true;
-}
\ No newline at end of file
+    });
+    return CloseFile(fileOut, filename);
+}
+
+#ifdef ASSIMP_USE
+template class AssimpMeshExporter<real_t>;
+#endif
+template class OffMeshExporter<real_t>;
+template class ObjMeshExporter<real_t>;
+template class PlyMeshExporter<real_t>;
+
+#ifdef SINGLE_PRECISION_USE
+#ifdef ASSIMP_USE
+template class AssimpMeshExporter<float>;
+#endif
+template class OffMeshExporter<float>;
+template class ObjMeshExporter<float>;
+template class PlyMeshExporter<float>;
+#endif
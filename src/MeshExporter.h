@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gismo.h>
+#include <functional>
 
 #ifdef ASSIMP_USE
 #include <assimp/Exporter.hpp>
@@ -9,6 +10,8 @@
 
 #include "MeshStrategy.h"
 
+// Exporters are templated on the scalar type of the mesh they write.
+template<class T = real_t>
 class BasisMeshExporter
 {
 protected:
@@ -21,6 +24,35 @@ protected:
         {255, 0, 255},
         {0, 255, 255}
     };
+    // Per-vertex normals (3 x numVertices), used by the formats that can store them.
+    const gsMatrix<T> *_normals = nullptr;
+
+    // Worker threads used to format text output, 0 for the hardware concurrency.
+    int _numThreads = 0;
+    // Cause of the last failed export, returned to the caller instead of printed
+    // so that concurrent writers report their errors per file.
+    std::string _error;
+
+    // Number format of text coordinates: fixed decimals for real_t meshes, and
+    // enough significant digits to round-trip every value of a float mesh.
+    static void SetTextFormat(std::ostream &out) {
+        if(std::is_same<T, float>::value) {
+            out << std::defaultfloat << std::setprecision(std::numeric_limits<float>::max_digits10);
+        } else {
+            out << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
+        }
+    }
+    bool HasNormals(const gismo::gsMesh<T> &mesh) const {
+        return _normals && _normals->cols() == static_cast<index_t>(mesh.numVertices());
+    }
+    // Format the elements [0, count) in chunks on worker threads and write the
+    // chunk buffers to out in order. Chunks use the float format set on out.
+    // Returns false as soon as a chunk fails to write, without formatting the rest;
+    // callers then stop and let CloseFile record the failed file.
+    bool WriteChunked(std::ostream &out, size_t count,
+                      const std::function<void(std::ostream &, size_t, size_t)> &format) const;
+    // Close out and record a failed write of filename.
+    bool CloseFile(std::fstream &out, const std::string &filename);
 public:
     BasisMeshExporter(OptionFlag optionFlag = static_cast<OptionFlag>(0))
         : _optionFlag(optionFlag) {}
@@ -28,64 +60,130 @@ public:
     virtual void SetColors(const std::vector<std::array<index_t, 3>> &colors) {
         _colors = colors;
     }
-    virtual bool ExportMesh(const gismo::gsMesh<> &mesh,
-                            const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+    virtual void SetNormals(const gsMatrix<T> *normals) {
+        _normals = normals;
+    }
+    virtual void SetNumThreads(int numThreads) {
+        _numThreads = numThreads;
+    }
+    // Whether the output holds vertex normals, so they only get computed when needed.
+    virtual bool UsesNormals() const {
+        return false;
+    }
+    virtual bool ExportMesh(const gismo::gsMesh<T> &mesh,
+                            const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                             const std::string &format,
                             const std::string &filename) = 0;
+    const std::string &GetError() const {
+        return _error;
+    }
 };
 
 #ifdef ASSIMP_USE
-class AssimpMeshExporter : public BasisMeshExporter
+template<class T = real_t>
+class AssimpMeshExporter : public BasisMeshExporter<T>
 {
+protected:
+    using Base = BasisMeshExporter<T>;
+    using Base::_optionFlag;
+    using Base::_colors;
+    using Base::_error;
+    using Base::_normals;
+    using Base::HasNormals;
 private:
-    void ExportMeshtoScene(const gismo::gsMesh<> &mesh,
-                           const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+    // Face indices of every aiMesh point into this single buffer.
+    std::vector<unsigned int> _indexPool;
+
+    void ExportMeshtoScene(const gismo::gsMesh<T> &mesh,
+                           const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                            aiScene &scene);
+    void ReleaseIndexPool(aiScene &scene);
 public:
     AssimpMeshExporter(OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshExporter(optionFlag) {}
-    virtual bool ExportMesh(const gismo::gsMesh<> &mesh,
-                            const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+        : BasisMeshExporter<T>(optionFlag) {}
+    virtual bool UsesNormals() const override {
+        return true;
+    }
+    virtual bool ExportMesh(const gismo::gsMesh<T> &mesh,
+                            const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                             const std::string &format,
                             const std::string &filename) override;
 };
 #endif
 
-class OffMeshExporter : public BasisMeshExporter
+template<class T = real_t>
+class OffMeshExporter : public BasisMeshExporter<T>
 {
+protected:
+    using Base = BasisMeshExporter<T>;
+    using Base::_optionFlag;
+    using Base::_colors;
+    using Base::_error;
+    using Base::SetTextFormat;
+    using Base::WriteChunked;
+    using Base::CloseFile;
 public:
     OffMeshExporter(OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshExporter(optionFlag) {}
-    virtual bool ExportMesh(const gismo::gsMesh<> &mesh,
-                            const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+        : BasisMeshExporter<T>(optionFlag) {}
+    virtual bool ExportMesh(const gismo::gsMesh<T> &mesh,
+                            const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                             const std::string &format,
                             const std::string &filename) override;
 };
 
-class ObjMeshExporter : public BasisMeshExporter
+template<class T = real_t>
+class ObjMeshExporter : public BasisMeshExporter<T>
 {
+protected:
+    using Base = BasisMeshExporter<T>;
+    using Base::_optionFlag;
+    using Base::_colors;
+    using Base::_error;
+    using Base::SetTextFormat;
+    using Base::WriteChunked;
+    using Base::CloseFile;
 private:
-    bool ExportMeshOnly(const gismo::gsMesh<> &mesh,
+    bool ExportMeshOnly(const gismo::gsMesh<T> &mesh,
                         const std::string &filename);
-    bool ExportMeshWithColor(const gismo::gsMesh<> &mesh,
-                             const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+    bool ExportMeshWithColor(const gismo::gsMesh<T> &mesh,
+                             const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                              const std::string &filename);
 public:
     ObjMeshExporter(OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshExporter(optionFlag) {}
-    virtual bool ExportMesh(const gismo::gsMesh<> &mesh,
-                            const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+        : BasisMeshExporter<T>(optionFlag) {}
+    virtual bool ExportMesh(const gismo::gsMesh<T> &mesh,
+                            const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                             const std::string &format,
                             const std::string &filename) override;
 };
 
-class PlyMeshExporter : public BasisMeshExporter
+template<class T = real_t>
+class PlyMeshExporter : public BasisMeshExporter<T>
 {
+protected:
+    using Base = BasisMeshExporter<T>;
+    using Base::_optionFlag;
+    using Base::_colors;
+    using Base::_error;
+    using Base::_normals;
+    using Base::HasNormals;
+    using Base::SetTextFormat;
+    using Base::WriteChunked;
+    using Base::CloseFile;
+private:
+    // Binary PLY, with 16-bit positions over the bounding box and octahedral
+    // normals when QUANTIZE is set.
+    bool ExportBinary(const gismo::gsMesh<T> &mesh,
+                      const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
+                      const std::string &filename);
 public:
     PlyMeshExporter(OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshExporter(optionFlag) {}
-    virtual bool ExportMesh(const gismo::gsMesh<> &mesh,
-                            const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+        : BasisMeshExporter<T>(optionFlag) {}
+    virtual bool UsesNormals() const override {
+        return _optionFlag & BINARY_OUTPUT;
+    }
+    virtual bool ExportMesh(const gismo::gsMesh<T> &mesh,
+                            const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
                             const std::string &format,
                             const std::string &filename) override;
 };
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+    const int CACHE_SIZE = 32;
+
+    // Vertex score of Forsyth's "Linear-Speed Vertex Cache Optimisation".
+    float VertexScore(int cachePosition, index_t remainingFaces)
+    {
+        if(remainingFaces == 0) {
+            return -1.0f;
+        }
+        float score = 0.0f;
+        if(cachePosition >= 0) {
+            // The last triangle's vertices get a fixed score so that the next one
+            // does not simply reuse them in the same order.
+            score = cachePosition < 3 ? 0.75f
+                  : std::pow(1.0f - (cachePosition - 3) / static_cast<float>(CACHE_SIZE - 3), 1.5f);
+        }
+        // Favor vertices with few remaining triangles to finish them off.
+        return score + 2.0f / std::sqrt(static_cast<float>(remainingFaces));
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<std::array<index_t, 4>> &faces, size_t numVertices)
+{
+    const size_t numFaces = faces.size();
+    if(numFaces == 0) {
+        return;
+    }
+    // Vertex to triangle adjacency, the first remaining[v] entries of each list are not emitted yet.
+    std::vector<index_t> remaining(numVertices, 0), offsets(numVertices + 1, 0), adjacency(3 * numFaces);
+    for(const auto &face : faces) {
+        for(int k = 0; k < 3; k++) {
+            remaining[face[k]]++;
+        }
+    }
+    for(size_t v = 0; v < numVertices; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<index_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t f = 0; f < numFaces; f++) {
+        for(int k = 0; k < 3; k++) {
+            adjacency[fill[faces[f][k]]++] = f;
+        }
+    }
+
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices), faceScore(numFaces, 0.0f);
+    for(size_t v = 0; v < numVertices; v++) {
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    }
+    for(size_t f = 0; f < numFaces; f++) {
+        for(int k = 0; k < 3; k++) {
+            faceScore[f] += vertexScore[faces[f][k]];
+        }
+    }
+
+    std::vector<bool> emitted(numFaces, false);
+    std::vector<std::array<index_t, 4>> ordered;
+    ordered.reserve(numFaces);
+    std::vector<index_t> cache, newCache;
+    index_t best = std::max_element(faceScore.begin(), faceScore.end()) - faceScore.begin();
+    size_t scan = 0;
+    while(ordered.size() < numFaces) {
+        if(best < 0) {
+            // Nothing left around the cache, continue with the next unused triangle.
+            while(emitted[scan]) {
+                scan++;
+            }
+            best = scan;
+        }
+        emitted[best] = true;
+        ordered.push_back(faces[best]);
+
+        newCache.clear();
+        for(int k = 0; k < 3; k++) {
+            const index_t v = faces[best][k];
+            // Detach the triangle from the remaining list of its vertices.
+            index_t *begin = adjacency.data() + offsets[v];
+            index_t *last = begin + remaining[v] - 1;
+            std::iter_swap(std::find(begin, last + 1, best), last);
+            remaining[v]--;
+            newCache.push_back(v);
+        }
+        for(index_t v : cache) {
+            if(v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+                newCache.push_back(v);
+            }
+        }
+        for(size_t i = 0; i < newCache.size(); i++) {
+            const index_t v = newCache[i];
+            cachePosition[v] = i < static_cast<size_t>(CACHE_SIZE) ? static_cast<int>(i) : -1;
+            const float score = VertexScore(cachePosition[v], remaining[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for(index_t a = 0; a < remaining[v]; a++) {
+                faceScore[adjacency[offsets[v] + a]] += delta;
+            }
+        }
+        if(newCache.size() > static_cast<size_t>(CACHE_SIZE)) {
+            newCache.resize(CACHE_SIZE);
+        }
+        std::swap(cache, newCache);
+
+        // The best next triangle is one around the cached vertices.
+        best = -1;
+        float bestScore = -1.0f;
+        for(index_t v : cache) {
+            for(index_t a = 0; a < remaining[v]; a++) {
+                const index_t f = adjacency[offsets[v] + a];
+                if(faceScore[f] > bestScore) {
+                    bestScore = faceScore[f];
+                    best = f;
+                }
+            }
+        }
+    }
+    faces.swap(ordered);
+}
+
+std::vector<index_t> MeshOptimizer::OptimizeVertexFetch(std::vector<std::array<index_t, 4>> &faces, size_t numVertices)
+{
+    std::vector<index_t> remap(numVertices, -1), order;
+    order.reserve(numVertices);
+    for(auto &face : faces) {
+        for(auto &v : face) {
+            if(v < 0) {
+                continue;
+            }
+            if(remap[v] < 0) {
+                remap[v] = order.size();
+                order.push_back(v);
+            }
+            v = remap[v];
+        }
+    }
+    for(size_t v = 0; v < numVertices; v++) {
+        if(remap[v] < 0) {
+            remap[v] = order.size();
+            order.push_back(v);
+        }
+    }
+    return order;
+}
+
+template<class T>
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const gismo::gsMesh<T> &mesh, size_t maxVertices, size_t maxTriangles)
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<int> localIndex(mesh.numVertices(), -1);
+    Meshlet current;
+    auto flush = [&]() {
+        for(index_t v : current.vertices) {
+            localIndex[v] = -1;
+        }
+        meshlets.push_back(std::move(current));
+        current = Meshlet();
+    };
+    for(const auto &face : mesh.faces()) {
+        if(face->vertices.size() != 3) {
+            continue;
+        }
+        size_t newVertices = 0;
+        for(const auto &v : face->vertices) {
+            newVertices += localIndex[v->getId()] < 0;
+        }
+        if(current.vertices.size() + newVertices > maxVertices || current.triangles.size() / 3 + 1 > maxTriangles) {
+            flush();
+        }
+        for(const auto &v : face->vertices) {
+            if(localIndex[v->getId()] < 0) {
+                localIndex[v->getId()] = current.vertices.size();
+                current.vertices.push_back(v->getId());
+            }
+            current.triangles.push_back(static_cast<uint8_t>(localIndex[v->getId()]));
+        }
+    }
+    if(!current.triangles.empty()) {
+        flush();
+    }
+    return meshlets;
+}
+
+template std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const gismo::gsMesh<real_t> &, size_t, size_t);
+#ifdef SINGLE_PRECISION_USE
+template std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const gismo::gsMesh<float> &, size_t, size_t);
+#endif
+
+bool MeshOptimizer::SaveMeshlets(const std::vector<Meshlet> &meshlets, const std::string &filename, std::string &error)
+{
+    std::ofstream fileOut(filename, std::ios::out | std::ios::binary);
+    if(!fileOut.is_open()) {
+        error = "Failed to open file for writing: " + filename;
+        return false;
+    }
+    // Layout: "MSHL", count, then per meshlet (vertexOffset, vertexCount, triangleOffset, triangleCount)
+    // as uint32, followed by all uint32 vertex ids and all uint8 local triangle indices.
+    // The triangle offset counts local indices, three per triangle.
+    auto writeU32 = [&](uint32_t value) { fileOut.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    fileOut.write("MSHL", 4);
+    writeU32(meshlets.size());
+    uint32_t vertexOffset = 0, triangleOffset = 0;
+    for(const auto &meshlet : meshlets) {
+        writeU32(vertexOffset);
+        writeU32(meshlet.vertices.size());
+        writeU32(triangleOffset);
+        writeU32(meshlet.triangles.size() / 3);
+        vertexOffset += meshlet.vertices.size();
+        triangleOffset += meshlet.triangles.size();
+    }
+    for(const auto &meshlet : meshlets) {
+        for(index_t v : meshlet.vertices) {
+            writeU32(v);
+        }
+    }
+    for(const auto &meshlet : meshlets) {
+        fileOut.write(reinterpret_cast<const char *>(meshlet.triangles.data()), meshlet.triangles.size());
+    }
+    fileOut.close();
+    if(!fileOut) {
+        error = "Failed to write file: " + filename;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <gismo.h>
+
+struct Meshlet
+{
+    std::vector<index_t> vertices;       // Mesh vertex ids referenced by the meshlet
+    std::vector<uint8_t> triangles;      // Three local vertex indices per triangle
+};
+
+// Reordering passes for GPU consumption of triangle meshes. Faces are given as
+// vertex index lists so the passes run before the faces are added to a gsMesh.
+class MeshOptimizer
+{
+public:
+    // Reorder triangles for post-transform vertex cache locality (Forsyth).
+    static void OptimizeVertexCache(std::vector<std::array<index_t, 4>> &faces, size_t numVertices);
+    // Renumber vertices in order of first use by the faces. Returns the old id of
+    // every new vertex; unreferenced vertices are kept at the end.
+    static std::vector<index_t> OptimizeVertexFetch(std::vector<std::array<index_t, 4>> &faces, size_t numVertices);
+
+    // Split the triangles of mesh, in their current order, into meshlets.
+    template<class T>
+    static std::vector<Meshlet> BuildMeshlets(const gismo::gsMesh<T> &mesh,
+                                              size_t maxVertices = 64, size_t maxTriangles = 124);
+    static bool SaveMeshlets(const std::vector<Meshlet> &meshlets, const std::string &filename, std::string &error);
+};
@@ -1,59 +1,265 @@
 #include "MeshStrategy.h"
+#include "MeshOptimizer.h"
+#include <numeric>
 
-bool SurfaceMeshStrategy::BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample)
+template<class T>
+std::vector<std::vector<real_t>> BasisMeshStrategy<T>::UniformGridLines(const gsMatrix<> &support, const gsVector<int> &numSample, int dim)
 {
-    if(numSample.size() < 2 || support.rows() < 2) {
+    std::vector<std::vector<real_t>> gridLines(dim);
+    for(int d = 0; d < dim; d++) {
+        gridLines[d].resize(numSample[d] + 1);
+        for(int i = 0; i < numSample[d] + 1; i++) {
+            gridLines[d][i] = support(d, 0) + i / (double)numSample[d] * (support(d, 1) - support(d, 0));
+        }
+    }
+    return gridLines;
+}
+
+template<class T>
+void BasisMeshStrategy<T>::SetGridLines(const std::vector<std::vector<real_t>> &gridLines, int dim)
+{
+    _gridLines.assign(gridLines.begin(), gridLines.begin() + dim);
+    _numVertices = 0;
+    _vertexRemap.clear();
+}
+
+template<class T>
+index_t BasisMeshStrategy<T>::NodeVertex(const std::array<int, 3> &node) const
+{
+    const index_t index = StagedVertex(node);
+    return index < 0 || _vertexRemap.empty() ? index : _vertexRemap[index];
+}
+
+template<class T>
+void BasisMeshStrategy<T>::GetVerticesInBox(const gsMatrix<> &box, std::vector<index_t> &vertexIds) const
+{
+    const int dim = static_cast<int>(_gridLines.size());
+    if(dim == 0 || box.rows() < dim) {
+        return;
+    }
+    // Range of grid indices covered by the box in each direction.
+    std::array<int, 3> lo = {0, 0, 0}, hi = {0, 0, 0}, last = {0, 0, 0};
+    for(int d = 0; d < dim; d++) {
+        const auto &line = _gridLines[d];
+        lo[d] = std::lower_bound(line.begin(), line.end(), box(d, 0)) - line.begin();
+        hi[d] = std::upper_bound(line.begin(), line.end(), box(d, 1)) - line.begin() - 1;
+        last[d] = static_cast<int>(line.size()) - 1;
+        if(lo[d] > hi[d]) {
+            return;
+        }
+    }
+    std::vector<int> layers;
+    for(int i = lo[0]; i <= hi[0]; i++) {
+        for(int j = lo[1]; j <= hi[1]; j++) {
+            layers.clear();
+            if(dim == 3 && i != 0 && i != last[0] && j != 0 && j != last[1]) {
+                // Only the boundary of a volume grid holds vertices, skip the interior.
+                if(lo[2] == 0) layers.push_back(0);
+                if(hi[2] == last[2] && last[2] != 0) layers.push_back(last[2]);
+            } else {
+                for(int k = lo[2]; k <= hi[2]; k++) layers.push_back(k);
+            }
+            for(int k : layers) {
+                const index_t id = NodeVertex({i, j, k});
+                if(id >= 0) {
+                    vertexIds.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+template<class T>
+void BasisMeshStrategy<T>::GetVertexParameters(index_t begin, index_t n, gsMatrix<> &params, std::vector<index_t> &vertexIds) const
+{
+    params.resize(_gridLines.size(), n);
+    vertexIds.resize(n);
+    for(index_t c = 0; c < n; c++) {
+        const std::array<int, 3> node = StagedNode(begin + c);
+        for(size_t d = 0; d < _gridLines.size(); d++) {
+            params(d, c) = _gridLines[d][node[d]];
+        }
+        vertexIds[c] = _vertexRemap.empty() ? begin + c : _vertexRemap[begin + c];
+    }
+}
+
+template<class T>
+void BasisMeshStrategy<T>::GetVertexParameters(gsMatrix<> &params) const
+{
+    params.resize(_gridLines.size(), _numVertices);
+    for(size_t index = 0; index < _numVertices; index++) {
+        const std::array<int, 3> node = StagedNode(index);
+        const index_t id = _vertexRemap.empty() ? index : _vertexRemap[index];
+        for(size_t d = 0; d < _gridLines.size(); d++) {
+            params(d, id) = _gridLines[d][node[d]];
+        }
+    }
+}
+
+template<class T>
+void BasisMeshStrategy<T>::StageVertex(real_t x, real_t y, real_t z)
+{
+    _stagedPoints.push_back({static_cast<T>(x), static_cast<T>(y), static_cast<T>(z)});
+}
+
+template<class T>
+void BasisMeshStrategy<T>::StageCell(index_t v1, index_t v2, index_t v3, index_t v4)
+{
+    if(_optionFlag & INVERT_NORMAL) {
+        std::swap(v2, v3);
+    }
+    switch(_meshType) {
+    case TRIANGLE_MESH:
+        _stagedFaces.push_back({v1, v2, v3, -1});
+        _stagedFaces.push_back({v2, v4, v3, -1});
+        break;
+    case SQUARE_MESH:
+        _stagedFaces.push_back({v1, v2, v4, v3});
+        break;
+    default:
+        gsInfo << "Unsupported mesh type: " << _meshType << ". Defaulting to TRIANGLE_MESH.\n";
+        _stagedFaces.push_back({v1, v2, v3, -1});
+        _stagedFaces.push_back({v2, v4, v3, -1});
+        break;
+    }
+}
+
+template<class T>
+void BasisMeshStrategy<T>::CommitMesh(gismo::gsMesh<T> &mesh)
+{
+    const size_t numPoints = _stagedPoints.size();
+    std::vector<index_t> order(numPoints);
+    std::iota(order.begin(), order.end(), 0);
+    if(_optionFlag & OPTIMIZE_VERTEX_CACHE) {
+        if(_meshType == SQUARE_MESH) {
+            gsInfo << "Vertex cache optimization only applies to triangle meshes, skipped.\n";
+        } else {
+            MeshOptimizer::OptimizeVertexCache(_stagedFaces, numPoints);
+            order = MeshOptimizer::OptimizeVertexFetch(_stagedFaces, numPoints);
+            // Faces now refer to the new vertex order, the grid nodes still to the old one.
+            _vertexRemap.resize(numPoints);
+            for(size_t i = 0; i < numPoints; i++) {
+                _vertexRemap[order[i]] = i;
+            }
+        }
+    }
+
+    std::vector<VertexHandle> handles(numPoints);
+    for(size_t i = 0; i < numPoints; i++) {
+        const auto &p = _stagedPoints[order[i]];
+        handles[i] = mesh.addVertex(p[0], p[1], p[2]);
+    }
+    for(const auto &f : _stagedFaces) {
+        if(f[3] < 0) {
+            mesh.addFace(handles[f[0]], handles[f[1]], handles[f[2]]);
+        } else {
+            mesh.addFace(handles[f[0]], handles[f[1]], handles[f[2]], handles[f[3]]);
+        }
+    }
+    _numVertices = numPoints;
+    _stagedPoints.clear();
+    _stagedPoints.shrink_to_fit();
+    _stagedFaces.clear();
+    _stagedFaces.shrink_to_fit();
+}
+
+template<class T>
+bool SurfaceMeshStrategy<T>::BuildMesh(gismo::gsMesh<T> &mesh, const std::vector<std::vector<real_t>> &gridLines)
+{
+    if(gridLines.size() < 2 || gridLines[0].size() < 2 || gridLines[1].size() < 2) {
         gsInfo << "Invalid support or numSample size for surface mesh generation.\n";
         return false;
     }
-    std::map<std::array<int, 2>, VertexHandle> vertexMap;
+    SetGridLines(gridLines, 2);
+    const std::array<int, 2> numSample = {static_cast<int>(gridLines[0].size()) - 1,
+                                          static_cast<int>(gridLines[1].size()) - 1};
     // Create vertices.
     for(int i = 0; i < numSample[0] + 1; i++) {
         for(int j = 0; j  < numSample[1] + 1; j++) {
-            gismo::gsVector<> point(3);
-            point[0] = support(0, 0) + i / (double)numSample[0] * (support(0, 1) - support(0, 0));
-            point[1] = support(1, 0) + j / (double)numSample[1] * (support(1, 1) - support(1, 0));
-            point[2] = 0.0; // Assuming a surface in the XY plane
-            auto v = mesh.addVertex(point);
-            vertexMap[{i, j}] = v;
+            // Assuming a surface in the XY plane
+            StageVertex(_gridLines[0][i], _gridLines[1][j], 0.0);
         }
     }
     // Create faces.
     for(int i = 0; i < numSample[0]; i++) {
         for(int j = 0; j < numSample[1]; j++) {
-            auto v1 = vertexMap[{i, j}];
-            auto v2 = vertexMap[{i + 1, j}];
-            auto v3 = vertexMap[{i, j + 1}];
-            auto v4 = vertexMap[{i + 1, j + 1}];
-            if(_optionFlag & INVERT_NORMAL) {
-                std::swap(v2, v3);
-            }
-            switch(_meshType) {
-            case TRIANGLE_MESH:
-                mesh.addFace(v1, v2, v3);
-                mesh.addFace(v2, v4, v3);
-                break;
-            case SQUARE_MESH:
-                mesh.addFace(v1, v2, v4, v3);
-                break;
-            default:
-                gsInfo << "Unsupported mesh type: " << _meshType << ". Defaulting to TRIANGLE_MESH.\n";
-                mesh.addFace(v1, v2, v3);
-                mesh.addFace(v2, v4, v3);
-                break;
-            }
+            StageCell(StagedVertex({i, j, 0}), StagedVertex({i + 1, j, 0}),
+                      StagedVertex({i, j + 1, 0}), StagedVertex({i + 1, j + 1, 0}));
         }
     }
+    CommitMesh(mesh);
     return true;
 }
 
-bool VolumeSurfaceMeshStrategy::BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample)
+template<class T>
+index_t SurfaceMeshStrategy<T>::StagedVertex(const std::array<int, 3> &node) const
+{
+    return node[0] * static_cast<index_t>(_gridLines[1].size()) + node[1];
+}
+
+template<class T>
+std::array<int, 3> SurfaceMeshStrategy<T>::StagedNode(index_t index) const
 {
-    if(numSample.size() < 3 || support.rows() < 3) {
+    const index_t n1 = _gridLines[1].size();
+    return {static_cast<int>(index / n1), static_cast<int>(index % n1), 0};
+}
+
+template<class T>
+index_t VolumeSurfaceMeshStrategy<T>::StagedVertex(const std::array<int, 3> &node) const
+{
+    const index_t n0 = _gridLines[0].size() - 1, n1 = _gridLines[1].size() - 1, n2 = _gridLines[2].size() - 1;
+    const index_t slab = (n1 + 1) * (n2 + 1), ring = 2 * (n2 + 1) + 2 * (n1 - 1);
+    const index_t i = node[0], j = node[1], k = node[2];
+    if(i == 0 || i == n0) {
+        return (i == 0 ? 0 : slab + (n0 - 1) * ring) + j * (n2 + 1) + k;
+    }
+    const index_t base = slab + (i - 1) * ring;
+    if(j == 0) {
+        return base + k;
+    } else if(j == n1) {
+        return base + (n2 + 1) + 2 * (n1 - 1) + k;
+    } else if(k == 0 || k == n2) {
+        return base + (n2 + 1) + 2 * (j - 1) + (k == 0 ? 0 : 1);
+    }
+    return -1; // Interior node
+}
+
+template<class T>
+std::array<int, 3> VolumeSurfaceMeshStrategy<T>::StagedNode(index_t index) const
+{
+    const index_t n0 = _gridLines[0].size() - 1, n1 = _gridLines[1].size() - 1, n2 = _gridLines[2].size() - 1;
+    const index_t slab = (n1 + 1) * (n2 + 1), ring = 2 * (n2 + 1) + 2 * (n1 - 1);
+    if(index < slab) {
+        return {0, static_cast<int>(index / (n2 + 1)), static_cast<int>(index % (n2 + 1))};
+    }
+    if(index >= slab + (n0 - 1) * ring) {
+        index -= slab + (n0 - 1) * ring;
+        return {static_cast<int>(n0), static_cast<int>(index / (n2 + 1)), static_cast<int>(index % (n2 + 1))};
+    }
+    index -= slab;
+    const int i = static_cast<int>(1 + index / ring);
+    index_t t = index % ring;
+    if(t < n2 + 1) {
+        return {i, 0, static_cast<int>(t)};
+    }
+    t -= n2 + 1;
+    if(t < 2 * (n1 - 1)) {
+        return {i, static_cast<int>(1 + t / 2), static_cast<int>(t % 2 == 0 ? 0 : n2)};
+    }
+    return {i, static_cast<int>(n1), static_cast<int>(t - 2 * (n1 - 1))};
+}
+
+template<class T>
+bool VolumeSurfaceMeshStrategy<T>::BuildMesh(gismo::gsMesh<T> &mesh, const std::vector<std::vector<real_t>> &gridLines)
+{
+    if(gridLines.size() < 3 || gridLines[0].size() < 2 || gridLines[1].size() < 2 || gridLines[2].size() < 2) {
         gsInfo << "Invalid support or numSample size for volume mesh generation.\n";
         return false;
     }
-    std::map<std::array<int, 3>, VertexHandle> vertexMap;
+    SetGridLines(gridLines, 3);
+    const std::array<int, 3> numSample = {static_cast<int>(gridLines[0].size()) - 1,
+                                          static_cast<int>(gridLines[1].size()) - 1,
+                                          static_cast<int>(gridLines[2].size()) - 1};
     // Create vertices.
     for(int i = 0; i < numSample[0] + 1; i++) {
         for(int j = 0; j < numSample[1] + 1; j++) {
@@ -62,85 +268,76 @@ bool VolumeSurfaceMeshStrategy::BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<
                    j == 0 || j == numSample[1] ||
                    k == 0 || k == numSample[2]) {
                     // Only create vertices on the boundary
-                    gismo::gsVector<> point(3);
-                    point[0] = support(0, 0) + i / (double)numSample[0] * (support(0, 1) - support(0, 0));
-                    point[1] = support(1, 0) + j / (double)numSample[1] * (support(1, 1) - support(1, 0));
-                    point[2] = support(2, 0) + k / (double)numSample[2] * (support(2, 1) - support(2, 0));
-                    auto v = mesh.addVertex(point);
-                    vertexMap[{i, j, k}] = v;
+                    StageVertex(_gridLines[0][i], _gridLines[1][j], _gridLines[2][k]);
                 }
             }
         }
     }
-    // Create faces.
+    // Create faces. Each side runs i and j over the two directions it spans.
+    const int sideAxes[6][2] = {{2, 1}, {0, 2}, {1, 0}, {0, 1}, {2, 0}, {1, 2}};
     for(int t = 0; t < 6; t++){
-        for(int i = 0; i < numSample[0]; i++) {
-            for(int j = 0; j < numSample[1]; j++) {
-                VertexHandle v1, v2, v3, v4;
+        for(int i = 0; i < numSample[sideAxes[t][0]]; i++) {
+            for(int j = 0; j < numSample[sideAxes[t][1]]; j++) {
+                index_t v1 = 0, v2 = 0, v3 = 0, v4 = 0;
                 switch(t) {
                 case 0:
                     // Back face
-                    v1 = vertexMap[{0, j, i}];
-                    v2 = vertexMap[{0, j, i + 1}];
-                    v3 = vertexMap[{0, j + 1, i}];
-                    v4 = vertexMap[{0, j + 1, i + 1}];
+                    v1 = StagedVertex({0, j, i});
+                    v2 = StagedVertex({0, j, i + 1});
+                    v3 = StagedVertex({0, j + 1, i});
+                    v4 = StagedVertex({0, j + 1, i + 1});
                     break;
                 case 1:
                     // Left face
-                    v1 = vertexMap[{i, 0, j}];
-                    v2 = vertexMap[{i + 1, 0, j}];
-                    v3 = vertexMap[{i, 0, j + 1}];
-                    v4 = vertexMap[{i + 1, 0, j + 1}];
+                    v1 = StagedVertex({i, 0, j});
+                    v2 = StagedVertex({i + 1, 0, j});
+                    v3 = StagedVertex({i, 0, j + 1});
+                    v4 = StagedVertex({i + 1, 0, j + 1});
                     break;
                 case 2:
                     // Bottom face
-                    v1 = vertexMap[{j, i, 0}];
-                    v2 = vertexMap[{j, i + 1, 0}];
-                    v3 = vertexMap[{j + 1, i, 0}];
-                    v4 = vertexMap[{j + 1, i + 1, 0}];
+                    v1 = StagedVertex({j, i, 0});
+                    v2 = StagedVertex({j, i + 1, 0});
+                    v3 = StagedVertex({j + 1, i, 0});
+                    v4 = StagedVertex({j + 1, i + 1, 0});
                     break;
                 case 3:
                     // Top face
-                    v1 = vertexMap[{i, j, numSample[2]}];
-                    v2 = vertexMap[{i + 1, j, numSample[2]}];
-                    v3 = vertexMap[{i, j + 1, numSample[2]}];
-                    v4 = vertexMap[{i + 1, j + 1, numSample[2]}];
+                    v1 = StagedVertex({i, j, numSample[2]});
+                    v2 = StagedVertex({i + 1, j, numSample[2]});
+                    v3 = StagedVertex({i, j + 1, numSample[2]});
+                    v4 = StagedVertex({i + 1, j + 1, numSample[2]});
                     break;
                 case 4:
                     // Right face
-                    v1 = vertexMap[{j, numSample[1], i}];
-                    v2 = vertexMap[{j, numSample[1], i + 1}];
-                    v3 = vertexMap[{j + 1, numSample[1], i}];
-                    v4 = vertexMap[{j + 1, numSample[1], i + 1}];
+                    v1 = StagedVertex({j, numSample[1], i});
+                    v2 = StagedVertex({j, numSample[1], i + 1});
+                    v3 = StagedVertex({j + 1, numSample[1], i});
+                    v4 = StagedVertex({j + 1, numSample[1], i + 1});
                     break;
                 case 5:
                     // Front face
-                    v1 = vertexMap[{numSample[0], i, j}];
-                    v2 = vertexMap[{numSample[0], i + 1, j}];
-                    v3 = vertexMap[{numSample[0], i, j + 1}];
-                    v4 = vertexMap[{numSample[0], i + 1, j + 1}];
+                    v1 = StagedVertex({numSample[0], i, j});
+                    v2 = StagedVertex({numSample[0], i + 1, j});
+                    v3 = StagedVertex({numSample[0], i, j + 1});
+                    v4 = StagedVertex({numSample[0], i + 1, j + 1});
                     break;
                 }
 
-                if(_optionFlag & INVERT_NORMAL) {
-                    std::swap(v2, v3);
-                }
-                switch(_meshType) {
-                case TRIANGLE_MESH:
-                    mesh.addFace(v1, v2, v3);
-                    mesh.addFace(v2, v4, v3);
-                    break;
-                case SQUARE_MESH:
-                    mesh.addFace(v1, v2, v4, v3);
-                    break;
-                default:
-                    gsInfo << "Unsupported mesh type: " << _meshType << ". Defaulting to TRIANGLE_MESH.\n";
-                    mesh.addFace(v1, v2, v3);
-                    mesh.addFace(v2, v4, v3);
-                    break;
-                }
+                StageCell(v1, v2, v3, v4);
             }
         }
     }
+    CommitMesh(mesh);
     return true; // Placeholder return value
-}
\ No newline at end of file
+}
+
+template class BasisMeshStrategy<real_t>;
+template class SurfaceMeshStrategy<real_t>;
+template class VolumeSurfaceMeshStrategy<real_t>;
+
+#ifdef SINGLE_PRECISION_USE
+template class BasisMeshStrategy<float>;
+template class SurfaceMeshStrategy<float>;
+template class VolumeSurfaceMeshStrategy<float>;
+#endif
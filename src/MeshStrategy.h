@@ -13,47 +13,116 @@ enum OptionFlag
 {
     INVERT_NORMAL = 1 << 0,
     WITH_COLOR = 1 << 1,
+    BINARY_OUTPUT = 1 << 2,
+    QUANTIZE = 1 << 3,
+    OPTIMIZE_VERTEX_CACHE = 1 << 4,
+    EMIT_MESHLETS = 1 << 5,
+    SINGLE_PRECISION = 1 << 6,
 };
 
+// Strategies are templated on the scalar type of the mesh. Parameters are always
+// computed in real_t, only the staged vertices are stored as T.
+template<class T = real_t>
 class BasisMeshStrategy
 {
 protected:
-    using VertexHandle = gismo::gsMesh<>::VertexHandle;
+    using VertexHandle = typename gismo::gsMesh<T>::VertexHandle;
 
     MeshType _meshType;
     OptionFlag _optionFlag;
 
+    // Parameter values of the sample grid in each direction. Vertices are staged
+    // in a fixed order over the grid nodes, so the vertex of a node follows from
+    // index arithmetic and only a remap is kept once they have been reordered.
+    std::vector<std::vector<real_t>> _gridLines;
+    size_t _numVertices = 0;
+    std::vector<index_t> _vertexRemap; // Staged index to vertex id, empty if unchanged
+
+    // Vertices and faces are staged as indices and only added to the mesh by
+    // CommitMesh, so that they can be reordered first.
+    std::vector<std::array<T, 3>> _stagedPoints;
+    std::vector<std::array<index_t, 4>> _stagedFaces; // Triangles end with -1
+
+    void SetGridLines(const std::vector<std::vector<real_t>> &gridLines, int dim);
+    void StageVertex(real_t x, real_t y, real_t z);
+    // Staged index of the vertex at a grid node (-1 if the node has none), and back.
+    virtual index_t StagedVertex(const std::array<int, 3> &node) const = 0;
+    virtual std::array<int, 3> StagedNode(index_t index) const = 0;
+    index_t NodeVertex(const std::array<int, 3> &node) const;
+    // Stage the grid cell v1-v2-v4-v3 as one quad or two triangles.
+    void StageCell(index_t v1, index_t v2, index_t v3, index_t v4);
+    void CommitMesh(gismo::gsMesh<T> &mesh);
+
 public:
     BasisMeshStrategy(MeshType meshType = TRIANGLE_MESH, OptionFlag optionFlag = static_cast<OptionFlag>(0))
         : _meshType(meshType), _optionFlag(optionFlag) {}
     virtual ~BasisMeshStrategy() = default;
-    virtual bool BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample) = 0;
-    virtual bool BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, int numSample = 64)
+    // Build on the tensor grid given by the parameter values in each direction.
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, const std::vector<std::vector<real_t>> &gridLines) = 0;
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample)
+    {
+        const int dim = std::min<int>(support.rows(), numSample.size());
+        return BuildMesh(mesh, UniformGridLines(support, numSample, dim));
+    }
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, const gsMatrix<> &support, int numSample = 64)
     {
         gsVector<int> numSampleVec(3);
         numSampleVec.setConstant(numSample);
         return BuildMesh(mesh, support, numSampleVec);
     }
-    virtual bool BuildMesh(gismo::gsMesh<> &mesh, int numSample = 64)
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, int numSample = 64)
     {
         gsMatrix<> support(3, 2);
         support << 0, 1, 0, 1, 0, 1; // Default support for a unit cube
         return BuildMesh(mesh, support, numSample);
     }
+    static std::vector<std::vector<real_t>> UniformGridLines(const gsMatrix<> &support, const gsVector<int> &numSample, int dim);
+    size_t GetNumVertices() const { return _numVertices; }
+    // Collect the ids of the vertices of the last built mesh whose parameters lie in box (parDim x 2).
+    virtual void GetVerticesInBox(const gsMatrix<> &box, std::vector<index_t> &vertexIds) const;
+    // Parameters (parDim x n) of the vertices staged at [begin, begin + n) in the last built mesh, and their ids.
+    void GetVertexParameters(index_t begin, index_t n, gsMatrix<> &params, std::vector<index_t> &vertexIds) const;
+    // Parameters of the vertices of the last built mesh (parDim x numVertices), indexed by vertex id.
+    void GetVertexParameters(gsMatrix<> &params) const;
 };
 
-class SurfaceMeshStrategy : public BasisMeshStrategy
+template<class T = real_t>
+class SurfaceMeshStrategy : public BasisMeshStrategy<T>
 {
+protected:
+    using Base = BasisMeshStrategy<T>;
+    using Base::_gridLines;
+    using Base::SetGridLines;
+    using Base::StageVertex;
+    using Base::StageCell;
+    using Base::CommitMesh;
+    // Staged row by row, grid node (i, j) is vertex i * (n1 + 1) + j.
+    virtual index_t StagedVertex(const std::array<int, 3> &node) const override;
+    virtual std::array<int, 3> StagedNode(index_t index) const override;
 public:
+    using Base::BuildMesh;
     SurfaceMeshStrategy(MeshType meshType = TRIANGLE_MESH, OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshStrategy(meshType, optionFlag) {}
-    virtual bool BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample) override;
+        : BasisMeshStrategy<T>(meshType, optionFlag) {}
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, const std::vector<std::vector<real_t>> &gridLines) override;
 };
 
-class VolumeSurfaceMeshStrategy : public BasisMeshStrategy
+template<class T = real_t>
+class VolumeSurfaceMeshStrategy : public BasisMeshStrategy<T>
 {
+protected:
+    using Base = BasisMeshStrategy<T>;
+    using Base::_gridLines;
+    using Base::SetGridLines;
+    using Base::StageVertex;
+    using Base::StageCell;
+    using Base::CommitMesh;
+    // Only boundary nodes are staged: the full first and last i slabs and, in
+    // between, the boundary ring of every (j, k) slab.
+    virtual index_t StagedVertex(const std::array<int, 3> &node) const override;
+    virtual std::array<int, 3> StagedNode(index_t index) const override;
 public:
+    using Base::BuildMesh;
     VolumeSurfaceMeshStrategy(MeshType meshType = TRIANGLE_MESH, OptionFlag optionFlag = static_cast<OptionFlag>(0))
-        : BasisMeshStrategy(meshType, optionFlag) {}
-    virtual bool BuildMesh(gismo::gsMesh<> &mesh, const gsMatrix<> &support, const gsVector<int> &numSample) override;
+        : BasisMeshStrategy<T>(meshType, optionFlag) {}
+    virtual bool BuildMesh(gismo::gsMesh<T> &mesh, const std::vector<std::vector<real_t>> &gridLines) override;
 };
\ No newline at end of file
@@ -1,4 +1,79 @@
 #include "SplineProcess.h"
+#include "ExportUtils.h"
+#include "MeshOptimizer.h"
+#include <future>
+#include <numeric>
+
+namespace
+{
+    // Newell's method, valid for both triangles and quads.
+    // The length is twice the face area and weights the vertex normals.
+    template<class T>
+    gsVector3d<T> FaceNormal(const gismo::gsFace<T> &face)
+    {
+        const auto &vertices = face.vertices;
+        gsVector3d<T> n = gsVector3d<T>::Zero();
+        for(size_t i = 0; i < vertices.size(); ++i) {
+            const auto &a = *vertices[i];
+            const auto &b = *vertices[(i + 1) % vertices.size()];
+            n.x() += (a.y() - b.y()) * (a.z() + b.z());
+            n.y() += (a.z() - b.z()) * (a.x() + b.x());
+            n.z() += (a.x() - b.x()) * (a.y() + b.y());
+        }
+        return n;
+    }
+
+    // Area weighted vertex normals of a whole mesh.
+    template<class T>
+    gsMatrix<T> AccumulateVertexNormals(const gismo::gsMesh<T> &mesh)
+    {
+        gsMatrix<T> normals = gsMatrix<T>::Zero(3, mesh.numVertices());
+        for(const auto &face : mesh.faces()) {
+            const gsVector3d<T> n = FaceNormal(*face);
+            for(const auto &v : face->vertices) {
+                normals.col(v->getId()) += n;
+            }
+        }
+        for(index_t i = 0; i < normals.cols(); ++i) {
+            const T norm = normals.col(i).norm();
+            if(norm > 0) {
+                normals.col(i) /= norm;
+            }
+        }
+        return normals;
+    }
+
+    template<class T>
+    void LabelVolumeFaces(const gismo::gsMesh<T> &mesh, const gismo::gsMatrix<> &support,
+                          std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap)
+    {
+        // The mesh stores the support bounds rounded to T.
+        auto bound = [&](index_t d, index_t side) { return static_cast<double>(static_cast<T>(support(d, side))); };
+        for(const auto &face : mesh.faces()) {
+            gismo::gsVector<double> point = gismo::gsVector<double>::Zero(3);
+            // Calculate the center of the face by averaging the vertices
+            for(const auto &v : face->vertices) {
+                point.x() += v->x();
+                point.y() += v->y();
+                point.z() += v->z();
+            }
+            point /= face->vertices.size();
+            if(point.x() == bound(0, 0)){
+                faceIndexMap[face] = 0; // Back face
+            } else if(point.x() == bound(0, 1)) {
+                faceIndexMap[face] = 5; // Front face
+            } else if(point.y() == bound(1, 0)) {
+                faceIndexMap[face] = 1; // Left face
+            } else if(point.y() == bound(1, 1)) {
+                faceIndexMap[face] = 4; // Right face
+            } else if(point.z() == bound(2, 0)) {
+                faceIndexMap[face] = 2; // Bottom face
+            } else if(point.z() == bound(2, 1)) {
+                faceIndexMap[face] = 3; // Top face
+            }
+        }
+    }
+}
 
 bool BasisSplineProcess::LoadSplinefromFile(const std::string &filename)
 {
@@ -37,6 +112,44 @@ void BasisSplineProcess::SaveSplinetoFile(const std::string &filename)
     gsInfo << "Saving done.\n";
 }
 
+bool BasisSplineProcess::SetAutoResolution(real_t edgeLength, real_t chordTolerance, int64_t maxVertices)
+{
+    if(!_spline_ptr) {
+        gsInfo << "No spline loaded to choose the resolution.\n";
+        return false;
+    }
+    if(!AutoResolution::ComputeGridLines(*_spline_ptr, edgeLength, chordTolerance, _sampleLines)) {
+        return false;
+    }
+    // Surfaces keep every grid node, volumes only the ones on the boundary.
+    std::array<int64_t, 3> numNodes = {1, 1, 1};
+    for(size_t d = 0; d < _sampleLines.size() && d < 3; d++) {
+        numNodes[d] = _sampleLines[d].size();
+    }
+    int64_t numVertices = numNodes[0] * numNodes[1] * numNodes[2];
+    if(_sampleLines.size() == 3) {
+        numVertices -= std::max<int64_t>(numNodes[0] - 2, 0) * std::max<int64_t>(numNodes[1] - 2, 0) * std::max<int64_t>(numNodes[2] - 2, 0);
+    }
+    if(maxVertices > 0 && numVertices > maxVertices) {
+        gsInfo << "Automatic resolution gives " << numVertices << " vertices, more than the " << maxVertices
+               << " this output mode supports. Use a larger -e or -c.\n";
+        _sampleLines.clear();
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::vector<real_t>> BasisSplineProcess::SampleLines(index_t numSample) const
+{
+    if(!_sampleLines.empty()) {
+        return _sampleLines;
+    }
+    const gsMatrix<> support = _spline_ptr->support();
+    gsVector<int> num(support.rows());
+    num.setConstant(numSample);
+    return BasisMeshStrategy<>::UniformGridLines(support, num, support.rows());
+}
+
 void BasisSplineProcess::BuildSurfacetoMesh(gismo::gsMesh<> &mesh, std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap, index_t numSample)
 {
     if(!_spline_ptr) {
@@ -46,55 +159,378 @@ void BasisSplineProcess::BuildSurfacetoMesh(gismo::gsMesh<> &mesh, std::map<gism
     if(!_meshStrategyPtr) {
         InitializeMeshStrategy();
     }
-    if(_meshStrategyPtr->BuildMesh(mesh, _spline_ptr->support(), numSample)){
+    if(_meshStrategyPtr->BuildMesh(mesh, SampleLines(numSample))){
         SetMeshColorIndexMap(mesh, _spline_ptr->support(), faceIndexMap);
         _spline_ptr->evaluateMesh(mesh);
+        // Normals and data for local edits belong to the previous mesh, see PrepareUpdate.
+        _vertexNormals.resize(0, 0);
+        _parameters.resize(0, 0);
+        _faceNormals.resize(0, 0);
+        _vertexFaceOffsets.clear();
+        _vertexFaceIds.clear();
     } else {
         gsInfo << "Failed to build mesh.\n";
         return;
     }
 };
 
-bool BasisSplineProcess::SaveMeshtoFile(const gismo::gsMesh<> &mesh,
-                                        const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
-                                        const std::string &filename)
+#ifdef SINGLE_PRECISION_USE
+void BasisSplineProcess::BuildSurfacetoMesh(gismo::gsMesh<float> &mesh, std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap, index_t numSample)
 {
-    std::string format = filename.substr(filename.find_last_of('.') + 1);
+    if(!_spline_ptr) {
+        gsInfo << "No spline loaded to build mesh.\n";
+        return;
+    }
+    if(!_meshStrategySinglePtr) {
+        InitializeMeshStrategy();
+    }
+    if(!_meshStrategySinglePtr->BuildMesh(mesh, SampleLines(numSample))) {
+        gsInfo << "Failed to build mesh.\n";
+        return;
+    }
+    SetMeshColorIndexMap(mesh, _spline_ptr->support(), faceIndexMap);
+
+    // gismo evaluates in real_t: evaluate blocks at the exact double parameters
+    // and narrow the results, tracking the deviation from the double pipeline.
+    // The parameters of a block are taken from the grid when it is evaluated, so
+    // only one block of them is ever held next to the float mesh.
+    gsMatrix<> block, values;
+    std::vector<index_t> vertexIds;
+    const index_t numVertices = mesh.numVertices(), blockSize = 1 << 14;
+    real_t maxError = 0, maxValue = 0;
+    for(index_t b = 0; b < numVertices; b += blockSize) {
+        const index_t n = std::min<index_t>(blockSize, numVertices - b);
+        _meshStrategySinglePtr->GetVertexParameters(b, n, block, vertexIds);
+        _spline_ptr->eval_into(block, values);
+        const index_t tarDim = std::min<index_t>(values.rows(), 3);
+        for(index_t c = 0; c < n; ++c) {
+            auto &vertex = *mesh.vertices()[vertexIds[c]];
+            for(index_t r = 0; r < tarDim; ++r) {
+                vertex[r] = static_cast<float>(values(r, c));
+                maxError = std::max<real_t>(maxError, std::abs(values(r, c) - vertex[r]));
+                maxValue = std::max<real_t>(maxValue, std::abs(values(r, c)));
+            }
+        }
+    }
+    gsInfo << "Single precision mesh: max deviation from double evaluation " << maxError
+           << " (relative " << (maxValue > 0 ? maxError / maxValue : 0) << ").\n";
+}
+#endif
+
+void BasisSplineProcess::PrepareUpdate(const gismo::gsMesh<> &mesh)
+{
+    _meshStrategyPtr->GetVertexParameters(_parameters);
+
+    // Vertex to face adjacency in CSR form, filled the same way as in MeshOptimizer.
+    const size_t numVertices = mesh.numVertices(), numFaces = mesh.numFaces();
+    _vertexFaceOffsets.assign(numVertices + 1, 0);
+    for(const auto &face : mesh.faces()) {
+        for(const auto &v : face->vertices) {
+            _vertexFaceOffsets[v->getId() + 1]++;
+        }
+    }
+    std::partial_sum(_vertexFaceOffsets.begin(), _vertexFaceOffsets.end(), _vertexFaceOffsets.begin());
+    _vertexFaceIds.resize(_vertexFaceOffsets.back());
+    std::vector<index_t> fill(_vertexFaceOffsets.begin(), _vertexFaceOffsets.end() - 1);
+    for(size_t f = 0; f < numFaces; ++f) {
+        for(const auto &v : mesh.faces()[f]->vertices) {
+            _vertexFaceIds[fill[v->getId()]++] = f;
+        }
+    }
+
+    std::vector<index_t> faceIds(numFaces), vertexIds(numVertices);
+    std::iota(faceIds.begin(), faceIds.end(), 0);
+    std::iota(vertexIds.begin(), vertexIds.end(), 0);
+    _faceNormals.setZero(3, numFaces);
+    ComputeFaceNormals(mesh, faceIds);
+    _vertexNormals.setZero(3, numVertices);
+    ComputeVertexNormals(vertexIds);
+}
+
+void BasisSplineProcess::ComputeFaceNormals(const gismo::gsMesh<> &mesh, const std::vector<index_t> &faceIds)
+{
+    for(index_t f : faceIds) {
+        _faceNormals.col(f) = FaceNormal(*mesh.faces()[f]);
+    }
+}
+
+void BasisSplineProcess::ComputeVertexNormals(const std::vector<index_t> &vertexIds)
+{
+    for(index_t v : vertexIds) {
+        gsVector3d<real_t> n = gsVector3d<real_t>::Zero();
+        for(index_t a = _vertexFaceOffsets[v]; a < _vertexFaceOffsets[v + 1]; ++a) {
+            n += _faceNormals.col(_vertexFaceIds[a]);
+        }
+        const real_t norm = n.norm();
+        if(norm > 0) {
+            n /= norm;
+        }
+        _vertexNormals.col(v) = n;
+    }
+}
+
+bool BasisSplineProcess::UpdateControlPoints(gismo::gsMesh<> &mesh, const std::vector<index_t> &indices, const gsMatrix<> &coefs)
+{
+    if(!_spline_ptr || !_meshStrategyPtr) {
+        gsInfo << "No spline loaded to update.\n";
+        return false;
+    }
+    if(_meshStrategyPtr->GetNumVertices() != mesh.numVertices()) {
+        gsInfo << "Mesh was not built by this process, call BuildSurfacetoMesh first.\n";
+        return false;
+    }
+    if(coefs.rows() != static_cast<index_t>(indices.size()) || coefs.cols() != _spline_ptr->coefs().cols()) {
+        gsInfo << "Control point update expects " << indices.size() << " x " << _spline_ptr->coefs().cols()
+               << " coefficients, got " << coefs.rows() << " x " << coefs.cols() << ".\n";
+        return false;
+    }
+
+    // Write the new coefficients and gather the vertices in the support of each one,
+    // i.e. in the knot spans influenced by the edited control points.
+    std::vector<index_t> vertexIds;
+    for(size_t r = 0; r < indices.size(); ++r) {
+        if(indices[r] < 0 || indices[r] >= _spline_ptr->coefs().rows()) {
+            gsInfo << "Control point index out of range: " << indices[r] << "\n";
+            return false;
+        }
+        _spline_ptr->coefs().row(indices[r]) = coefs.row(r);
+        _meshStrategyPtr->GetVerticesInBox(_spline_ptr->basis().support(indices[r]), vertexIds);
+    }
+    std::sort(vertexIds.begin(), vertexIds.end());
+    vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+    if(vertexIds.empty()) {
+        return true;
+    }
+
+    if(_vertexFaceOffsets.size() != mesh.numVertices() + 1) {
+        PrepareUpdate(mesh);
+    }
+
+    // Re-evaluate the affected vertices in one batch.
+    gsMatrix<> params(_parameters.rows(), vertexIds.size()), values;
+    for(size_t c = 0; c < vertexIds.size(); ++c) {
+        params.col(c) = _parameters.col(vertexIds[c]);
+    }
+    _spline_ptr->eval_into(params, values);
+    const index_t tarDim = std::min<index_t>(values.rows(), 3);
+    for(size_t c = 0; c < vertexIds.size(); ++c) {
+        mesh.vertices()[vertexIds[c]]->topRows(tarDim) = values.col(c).topRows(tarDim);
+    }
+
+    // Refresh the normals of the faces around the moved vertices, then of their corners.
+    std::vector<index_t> faceIds, cornerIds;
+    for(index_t v : vertexIds) {
+        faceIds.insert(faceIds.end(), _vertexFaceIds.begin() + _vertexFaceOffsets[v],
+                       _vertexFaceIds.begin() + _vertexFaceOffsets[v + 1]);
+    }
+    std::sort(faceIds.begin(), faceIds.end());
+    faceIds.erase(std::unique(faceIds.begin(), faceIds.end()), faceIds.end());
+    ComputeFaceNormals(mesh, faceIds);
+    for(index_t f : faceIds) {
+        for(const auto &v : mesh.faces()[f]->vertices) {
+            cornerIds.push_back(v->getId());
+        }
+    }
+    std::sort(cornerIds.begin(), cornerIds.end());
+    cornerIds.erase(std::unique(cornerIds.begin(), cornerIds.end()), cornerIds.end());
+    ComputeVertexNormals(cornerIds);
+
+    gsInfo << "Updated " << indices.size() << " control point" << (indices.size() == 1 ? "" : "s")
+           << ", re-evaluated " << vertexIds.size() << " vertices and " << faceIds.size() << " faces.\n";
+    return true;
+}
+
+template<class T>
+std::unique_ptr<BasisMeshExporter<T>> BasisSplineProcess::CreateMeshExporter(const std::string &format, const gsMatrix<T> *normals,
+                                                                       int numThreads) const
+{
+    std::unique_ptr<BasisMeshExporter<T>> exporterPtr;
     if(format == "off") {
-        _meshExporterPtr = std::make_unique<OffMeshExporter>(_optionFlag);
+        exporterPtr = std::make_unique<OffMeshExporter<T>>(_optionFlag);
     } else if (format == "obj") {
-        _meshExporterPtr = std::make_unique<ObjMeshExporter>(_optionFlag);
+        exporterPtr = std::make_unique<ObjMeshExporter<T>>(_optionFlag);
     } else if (format == "ply") {
-        _meshExporterPtr = std::make_unique<PlyMeshExporter>(_optionFlag);
+        exporterPtr = std::make_unique<PlyMeshExporter<T>>(_optionFlag);
     } else {
         #ifdef ASSIMP_USE
-        _meshExporterPtr = std::make_unique<AssimpMeshExporter>(_optionFlag);
+        exporterPtr = std::make_unique<AssimpMeshExporter<T>>(_optionFlag);
         #else
+        return nullptr;
+        #endif
+    }
+    exporterPtr->SetColors(_colors);
+    exporterPtr->SetNormals(normals);
+    exporterPtr->SetNumThreads(numThreads);
+    return exporterPtr;
+}
+
+bool BasisSplineProcess::SaveMeshtoFile(const gismo::gsMesh<> &mesh,
+                                        const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+                                        const std::string &filename)
+{
+    std::string format = filename.substr(filename.find_last_of('.') + 1);
+    _meshExporterPtr = CreateMeshExporter<real_t>(format, &_vertexNormals, _numThreads);
+    if(!_meshExporterPtr) {
         gsInfo << "Unsupported mesh format: " << format << ". Please use .off, .obj, or .ply.\n";
         return false;
-        #endif
+    }
+    if(_meshExporterPtr->UsesNormals() && _vertexNormals.cols() != static_cast<index_t>(mesh.numVertices())) {
+        _vertexNormals = AccumulateVertexNormals(mesh);
     }
     if(_meshExporterPtr->ExportMesh(mesh, faceIndexMap, format, filename)){
         gsInfo << "Mesh saved to file: " << filename << "\n";
         return true;
     } else {
-        gsInfo << "Failed to save mesh to file " << filename << " with format " << format << "\n";
+        gsInfo << "Failed to save mesh to file " << filename << " with format " << format;
+        if(!_meshExporterPtr->GetError().empty()) {
+            gsInfo << ": " << _meshExporterPtr->GetError();
+        }
+        gsInfo << "\n";
         return false;
     }
 }
 
+bool BasisSplineProcess::SaveMeshtoFiles(const gismo::gsMesh<> &mesh,
+                                         const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+                                         const std::vector<std::string> &filenames)
+{
+    if(filenames.size() == 1) {
+        return SaveMeshtoFile(mesh, faceIndexMap, filenames[0]);
+    }
+    return SaveMeshtoFiles<real_t>(mesh, faceIndexMap, filenames, _vertexNormals);
+}
+
+template<class T>
+bool BasisSplineProcess::SaveMeshtoFiles(const gismo::gsMesh<T> &mesh,
+                                         const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
+                                         const std::vector<std::string> &filenames, gsMatrix<T> &normals)
+{
+    // Every writer gets its own exporter and share of the threads, and only reads
+    // the shared mesh. Messages are collected per file and reported once all
+    // writers are done.
+    const int numThreads = ExportUtils::NumThreads(_numThreads);
+    const int writerThreads = std::max<int>(1, numThreads / static_cast<int>(filenames.size()));
+    // Exporters are created up front so that normals are only computed if one writes them.
+    std::vector<std::unique_ptr<BasisMeshExporter<T>>> exporters;
+    bool usesNormals = false;
+    for(const auto &filename : filenames) {
+        const std::string format = filename.substr(filename.find_last_of('.') + 1);
+        exporters.push_back(CreateMeshExporter<T>(format, &normals, writerThreads));
+        usesNormals = usesNormals || (exporters.back() && exporters.back()->UsesNormals());
+    }
+    if(usesNormals && normals.cols() != static_cast<index_t>(mesh.numVertices())) {
+        normals = AccumulateVertexNormals(mesh);
+    }
+    std::vector<std::future<std::string>> results;
+    for(size_t i = 0; i < filenames.size(); ++i) {
+        BasisMeshExporter<T> *exporterPtr = exporters[i].get();
+        results.push_back(std::async(std::launch::async, [&mesh, &faceIndexMap, exporterPtr, filename = filenames[i]]() -> std::string {
+            std::string format = filename.substr(filename.find_last_of('.') + 1);
+            if(!exporterPtr) {
+                return "Unsupported mesh format: " + format + ". Please use .off, .obj, or .ply.";
+            }
+            try {
+                if(!exporterPtr->ExportMesh(mesh, faceIndexMap, format, filename)) {
+                    const std::string &cause = exporterPtr->GetError();
+                    return "Failed to save mesh to file " + filename + " with format " + format
+                         + (cause.empty() ? "" : ": " + cause);
+                }
+            } catch(const std::exception &e) {
+                return "Failed to save mesh to file " + filename + ": " + e.what();
+            }
+            return "";
+        }));
+    }
+    bool success = true;
+    for(size_t i = 0; i < filenames.size(); ++i) {
+        std::string error = results[i].get();
+        if(error.empty()) {
+            gsInfo << "Mesh saved to file: " << filenames[i] << "\n";
+        } else {
+            gsInfo << error << "\n";
+            success = false;
+        }
+    }
+    return success;
+}
+
 bool BasisSplineProcess::BuildSurfacetoFile(const std::string &filename, index_t num)
+{
+    return BuildSurfacetoFile(std::vector<std::string>{filename}, num);
+}
+
+template<class T>
+bool BasisSplineProcess::SaveMeshlets(const gismo::gsMesh<T> &mesh, const std::string &filename) const
+{
+    if(_meshType != TRIANGLE_MESH) {
+        gsInfo << "Meshlets need a triangle mesh, no meshlets written.\n";
+        return false;
+    }
+    std::vector<Meshlet> meshlets = MeshOptimizer::BuildMeshlets(mesh);
+    std::string error;
+    if(!MeshOptimizer::SaveMeshlets(meshlets, filename + ".meshlets", error)) {
+        gsInfo << "Failed to save meshlets to file " << filename + ".meshlets: " << error << "\n";
+        return false;
+    }
+    gsInfo << "Meshlets (" << meshlets.size() << ") saved to file: " << filename + ".meshlets\n";
+    return true;
+}
+
+bool BasisSplineProcess::BuildSurfacetoFile(const std::vector<std::string> &filenames, index_t num)
 {
     gsInfo << "Building model to file...\n";
     if(!_spline_ptr) {
         gsInfo << "No spline loaded to build model.\n";
         return false;
     }
-    gismo::gsMesh<> mesh;
-    std::map<gismo::gsMesh<>::FaceHandle, index_t> faceIndexMap;
-    BuildSurfacetoMesh(mesh, faceIndexMap, num);
-    if(!SaveMeshtoFile(mesh, faceIndexMap, filename)){
-        gsInfo << "Failed to build model to file: " << filename << "\n";
+    bool saved = false, meshletsSaved = true;
+    #ifdef SINGLE_PRECISION_USE
+    if(_optionFlag & SINGLE_PRECISION) {
+        gismo::gsMesh<float> mesh;
+        std::map<gismo::gsMesh<float>::FaceHandle, index_t> faceIndexMap;
+        BuildSurfacetoMesh(mesh, faceIndexMap, num);
+        gsMatrix<float> normals;
+        saved = SaveMeshtoFiles<float>(mesh, faceIndexMap, filenames, normals);
+        meshletsSaved = !(saved && (_optionFlag & EMIT_MESHLETS)) || SaveMeshlets(mesh, filenames[0]);
+    } else
+    #else
+    if(_optionFlag & SINGLE_PRECISION) {
+        gsInfo << "Single precision meshes are not available in this build, using double precision.\n";
+    }
+    #endif
+    {
+        gismo::gsMesh<> mesh;
+        std::map<gismo::gsMesh<>::FaceHandle, index_t> faceIndexMap;
+        BuildSurfacetoMesh(mesh, faceIndexMap, num);
+        saved = SaveMeshtoFiles(mesh, faceIndexMap, filenames);
+        meshletsSaved = !(saved && (_optionFlag & EMIT_MESHLETS)) || SaveMeshlets(mesh, filenames[0]);
+    }
+    if(!saved){
+        gsInfo << "Failed to build model to file" << (filenames.size() == 1 ? ": " + filenames[0] : "s") << "\n";
+        return false;
+    }
+    if(!meshletsSaved) {
+        return false;
+    }
+
+    gsInfo << "Building model done.\n";
+    return true;
+}
+
+bool BasisSplineProcess::BuildSurfacetoFileTiled(const std::vector<std::string> &filenames, index_t num,
+                                                 size_t memoryBudget, int numThreads)
+{
+    gsInfo << "Building model to file in tiles...\n";
+    if(!_spline_ptr) {
+        gsInfo << "No spline loaded to build model.\n";
+        return false;
+    }
+    TiledMeshBuilder builder(*_spline_ptr, _meshType, _optionFlag);
+    builder.SetMemoryBudget(memoryBudget);
+    builder.SetNumThreads(numThreads);
+    builder.SetColor(_colors[0]);
+    if(!builder.BuildtoFile(filenames, SampleLines(num))) {
+        gsInfo << "Failed to build model in tiled mode.\n";
         return false;
     }
 
@@ -102,6 +538,32 @@ bool BasisSplineProcess::BuildSurfacetoFile(const std::string &filename, index_t
     return true;
 }
 
+bool BasisSplineProcess::BuildVolumetoFile(const std::vector<std::string> &filenames, index_t num, int numThreads)
+{
+    gsInfo << "Building volume grid to file...\n";
+    if(!_spline_ptr) {
+        gsInfo << "No spline loaded to build model.\n";
+        return false;
+    }
+    VolumeGridExporter exporter(*_spline_ptr, _optionFlag);
+    exporter.SetNumThreads(numThreads);
+    const std::vector<std::vector<real_t>> gridLines = SampleLines(num);
+    const bool success = exporter.ExportGrid(filenames, gridLines);
+    for(size_t i = 0; i < filenames.size(); ++i) {
+        if(exporter.GetError(i).empty()) {
+            gsInfo << "Volume grid saved to file: " << filenames[i] << "\n";
+        } else {
+            gsInfo << "Failed to save volume grid to file " << filenames[i] << ": " << exporter.GetError(i) << "\n";
+        }
+    }
+    if(!success) {
+        return false;
+    }
+
+    gsInfo << "Building volume grid done.\n";
+    return true;
+}
+
 void BasisSplineProcess::ShowExportFormatsSupported() const
 {
     gsInfo << "Supported export formats:\n";
@@ -127,30 +589,16 @@ void BasisSplineProcess::ShowExportFormatsSupported() const
 void VolumeSplineProcess::SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, const gismo::gsMatrix<> &support,
                                                std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap)
 {
-    for(const auto &face : mesh.faces()) {
-        gismo::gsVector<double> point = gismo::gsVector<double>::Zero(3);
-        // Calculate the center of the face by averaging the vertices
-        for(const auto &v : face->vertices) {
-            point.x() += v->x();
-            point.y() += v->y();
-            point.z() += v->z();
-        }
-        point /= face->vertices.size();
-        if(point.x() == support(0, 0)){
-            faceIndexMap[face] = 0; // Back face
-        } else if(point.x() == support(0, 1)) {
-            faceIndexMap[face] = 5; // Front face
-        } else if(point.y() == support(1, 0)) {
-            faceIndexMap[face] = 1; // Left face
-        } else if(point.y() == support(1, 1)) {
-            faceIndexMap[face] = 4; // Right face
-        } else if(point.z() == support(2, 0)) {
-            faceIndexMap[face] = 2; // Bottom face
-        } else if(point.z() == support(2, 1)) {
-            faceIndexMap[face] = 3; // Top face
-        }
-    }
+    LabelVolumeFaces(mesh, support, faceIndexMap);
+}
+
+#ifdef SINGLE_PRECISION_USE
+void VolumeSplineProcess::SetMeshColorIndexMap(const gismo::gsMesh<float> &mesh, const gismo::gsMatrix<> &support,
+                                               std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap)
+{
+    LabelVolumeFaces(mesh, support, faceIndexMap);
 }
+#endif
 
 void SurfaceSplineProcess::SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, const gismo::gsMatrix<> &support,
                                                std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap)
@@ -159,3 +607,13 @@ void SurfaceSplineProcess::SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, con
         faceIndexMap[face] = 0; // All faces are treated the same for surfaces
     }
 }
+
+#ifdef SINGLE_PRECISION_USE
+void SurfaceSplineProcess::SetMeshColorIndexMap(const gismo::gsMesh<float> &mesh, const gismo::gsMatrix<> &support,
+                                               std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap)
+{
+    for(const auto &face : mesh.faces()) {
+        faceIndexMap[face] = 0; // All faces are treated the same for surfaces
+    }
+}
+#endif
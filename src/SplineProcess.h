@@ -3,6 +3,9 @@
 #include <gismo.h>
 #include "MeshStrategy.h"
 #include "MeshExporter.h"
+#include "TiledMeshBuilder.h"
+#include "VolumeGridExporter.h"
+#include "AutoResolution.h"
 
 #define Eigen gsEigen
 
@@ -10,11 +13,17 @@ class BasisSplineProcess
 {
 protected:
     std::unique_ptr<gismo::gsGeometry<>> _spline_ptr;
-    std::unique_ptr<BasisMeshStrategy> _meshStrategyPtr;
-    std::unique_ptr<BasisMeshExporter> _meshExporterPtr = nullptr;
+    std::unique_ptr<BasisMeshStrategy<>> _meshStrategyPtr;
+#ifdef SINGLE_PRECISION_USE
+    std::unique_ptr<BasisMeshStrategy<float>> _meshStrategySinglePtr;
+#endif
+    std::unique_ptr<BasisMeshExporter<>> _meshExporterPtr = nullptr;
 
     OptionFlag _optionFlag = static_cast<OptionFlag>(0);
     MeshType _meshType = TRIANGLE_MESH;
+    // Threads for formatting output, 0 for the hardware concurrency. Concurrent
+    // writers share them.
+    int _numThreads = 0;
 
     std::vector<std::array<index_t, 3>> _colors = {
         {255, 0, 0},
@@ -24,6 +33,33 @@ protected:
         {255, 0, 255},
         {0, 255, 255}
     };
+
+    // Vertex normals of the evaluated mesh, computed when an exporter writes them.
+    // They, the vertex parameters, face normals and vertex to face adjacency (faces
+    // of v in _vertexFaceIds[_vertexFaceOffsets[v].._vertexFaceOffsets[v + 1]]) are
+    // built on the first local control point edit.
+    gsMatrix<> _vertexNormals;
+    gsMatrix<> _parameters;
+    gsMatrix<> _faceNormals;
+    std::vector<index_t> _vertexFaceOffsets;
+    std::vector<index_t> _vertexFaceIds;
+
+    // Parameter values per direction chosen by SetAutoResolution, empty for uniform sampling.
+    std::vector<std::vector<real_t>> _sampleLines;
+
+    template<class T>
+    std::unique_ptr<BasisMeshExporter<T>> CreateMeshExporter(const std::string &format, const gsMatrix<T> *normals,
+                                                            int numThreads) const;
+    template<class T>
+    bool SaveMeshtoFiles(const gismo::gsMesh<T> &mesh,
+                         const std::map<typename gismo::gsMesh<T>::FaceHandle, index_t> &faceIndexMap,
+                         const std::vector<std::string> &filenames, gsMatrix<T> &normals);
+    template<class T>
+    bool SaveMeshlets(const gismo::gsMesh<T> &mesh, const std::string &filename) const;
+    std::vector<std::vector<real_t>> SampleLines(index_t numSample) const;
+    void PrepareUpdate(const gismo::gsMesh<> &mesh);
+    void ComputeFaceNormals(const gismo::gsMesh<> &mesh, const std::vector<index_t> &faceIds);
+    void ComputeVertexNormals(const std::vector<index_t> &vertexIds);
 public:
     BasisSplineProcess(OptionFlag optionFlag = static_cast<OptionFlag>(0), MeshType meshType = TRIANGLE_MESH)
         : _optionFlag(optionFlag), _meshType(meshType) {}
@@ -34,8 +70,13 @@ public:
     BasisSplineProcess(BasisSplineProcess &other) {
         _spline_ptr = std::move(other._spline_ptr);
         _meshStrategyPtr = std::move(other._meshStrategyPtr);
+#ifdef SINGLE_PRECISION_USE
+        _meshStrategySinglePtr = std::move(other._meshStrategySinglePtr);
+#endif
+        _sampleLines = std::move(other._sampleLines);
         _optionFlag = other._optionFlag;
         _meshType = other._meshType;
+        _numThreads = other._numThreads;
     }
     virtual ~BasisSplineProcess() = default;
 
@@ -43,16 +84,45 @@ public:
     void SaveSplinetoFile(const std::string &filename);
 
     int GetDimension() const { return _spline_ptr->parDim(); }
+    void SetNumThreads(int numThreads) { _numThreads = numThreads; }
+
+    // Sample every knot span densely enough for the given edge length and chord
+    // tolerance instead of using numSample; derived once from the control net.
+    // Fails when the mesh would have more than maxVertices vertices (0 for no limit).
+    bool SetAutoResolution(real_t edgeLength, real_t chordTolerance, int64_t maxVertices = 0);
 
     virtual void InitializeMeshStrategy() {}
     virtual void BuildSurfacetoMesh(gismo::gsMesh<> &mesh, std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap, index_t numSample = 64);
     virtual void SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, const gismo::gsMatrix<> &support,
                                       std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap){};
+#ifdef SINGLE_PRECISION_USE
+    // Single precision pipeline: the mesh and the exporters use float. Evaluation runs
+    // in real_t and every narrowed block is checked against the double values.
+    // Needs gismo built with float instances, see CMakeLists.txt.
+    virtual void BuildSurfacetoMesh(gismo::gsMesh<float> &mesh, std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap, index_t numSample = 64);
+    virtual void SetMeshColorIndexMap(const gismo::gsMesh<float> &mesh, const gismo::gsMatrix<> &support,
+                                      std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap){};
+#endif
+
+    // Replace the control points listed in indices by the rows of coefs and
+    // re-evaluate only the mesh vertices inside the support of those control points.
+    virtual bool UpdateControlPoints(gismo::gsMesh<> &mesh, const std::vector<index_t> &indices, const gsMatrix<> &coefs);
+    const gsMatrix<> &GetVertexNormals() const { return _vertexNormals; }
 
     virtual bool SaveMeshtoFile(const gismo::gsMesh<> &mesh,
                                 const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
                                 const std::string &filename);
+    // Run one exporter per file concurrently on the same mesh.
+    virtual bool SaveMeshtoFiles(const gismo::gsMesh<> &mesh,
+                                 const std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap,
+                                 const std::vector<std::string> &filenames);
     virtual bool BuildSurfacetoFile(const std::string &filename, index_t numSample = 64);
+    virtual bool BuildSurfacetoFile(const std::vector<std::string> &filenames, index_t numSample = 64);
+    // Out-of-core variant: evaluate the grid in tiles bounded by memoryBudget bytes.
+    virtual bool BuildSurfacetoFileTiled(const std::vector<std::string> &filenames, index_t numSample,
+                                         size_t memoryBudget, int numThreads = 0);
+    // Interior sampling of a volume spline as a structured grid (.vts or .xmf).
+    virtual bool BuildVolumetoFile(const std::vector<std::string> &filenames, index_t numSample, int numThreads = 0);
 
     void ShowExportFormatsSupported() const;
 };
@@ -65,10 +135,17 @@ public:
     VolumeSplineProcess(BasisSplineProcess &other) : BasisSplineProcess(other) {}
 
     virtual void InitializeMeshStrategy() override {
-        _meshStrategyPtr = std::make_unique<VolumeSurfaceMeshStrategy>(_meshType, _optionFlag);
+        _meshStrategyPtr = std::make_unique<VolumeSurfaceMeshStrategy<>>(_meshType, _optionFlag);
+#ifdef SINGLE_PRECISION_USE
+        _meshStrategySinglePtr = std::make_unique<VolumeSurfaceMeshStrategy<float>>(_meshType, _optionFlag);
+#endif
     }
     virtual void SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, const gismo::gsMatrix<> &support,
                                       std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap) override;
+#ifdef SINGLE_PRECISION_USE
+    virtual void SetMeshColorIndexMap(const gismo::gsMesh<float> &mesh, const gismo::gsMatrix<> &support,
+                                      std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap) override;
+#endif
 };
 
 class SurfaceSplineProcess : public BasisSplineProcess
@@ -79,8 +156,15 @@ public:
     SurfaceSplineProcess(BasisSplineProcess &other) : BasisSplineProcess(other) {}
 
     virtual void InitializeMeshStrategy() override {
-        _meshStrategyPtr = std::make_unique<SurfaceMeshStrategy>(_meshType, _optionFlag);
+        _meshStrategyPtr = std::make_unique<SurfaceMeshStrategy<>>(_meshType, _optionFlag);
+#ifdef SINGLE_PRECISION_USE
+        _meshStrategySinglePtr = std::make_unique<SurfaceMeshStrategy<float>>(_meshType, _optionFlag);
+#endif
     }
     virtual void SetMeshColorIndexMap(const gismo::gsMesh<> &mesh, const gismo::gsMatrix<> &support,
                                       std::map<gismo::gsMesh<>::FaceHandle, index_t> &faceIndexMap) override;
+#ifdef SINGLE_PRECISION_USE
+    virtual void SetMeshColorIndexMap(const gismo::gsMesh<float> &mesh, const gismo::gsMatrix<> &support,
+                                      std::map<gismo::gsMesh<float>::FaceHandle, index_t> &faceIndexMap) override;
+#endif
 };
@@ -0,0 +1,271 @@
+#include "TiledMeshBuilder.h"
+#include "ExportUtils.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Smallest tile edge in grid nodes, keeps the number of tiles and the
+    // per-tile overhead bounded for small budgets.
+    const int64_t MIN_TILE_SIZE = 64;
+}
+
+size_t TiledMeshBuilder::BytesPerVertex() const
+{
+    // Footprint of one vertex during evaluation: its parameters, value and chunk
+    // entry plus the values and indices of the active basis functions gismo
+    // allocates per point, (p + 1) per direction for a tensor basis.
+    size_t numActive = 1;
+    for(short d = 0; d < _geometry.parDim(); d++) {
+        numActive *= _geometry.basis().degree(d) + 1;
+    }
+    return sizeof(real_t) * (2 + 3 + 3) + numActive * (sizeof(real_t) + sizeof(index_t));
+}
+
+void TiledMeshBuilder::SetNumThreads(int numThreads)
+{
+    _numThreads = ExportUtils::NumThreads(numThreads);
+}
+
+std::string TiledMeshBuilder::ChunkName(const std::string &prefix, int64_t a) const
+{
+    return prefix + ".band_" + std::to_string(a) + ".tmp";
+}
+
+bool TiledMeshBuilder::EvaluateTile(const std::string &prefix, int64_t a, int64_t b) const
+{
+    const int64_t i0 = a * _tileSize, i1 = std::min(i0 + _tileSize, _numNodes[0]);
+    const int64_t j0 = b * _tileSize, j1 = std::min(j0 + _tileSize, _numNodes[1]);
+    // Every grid node belongs to exactly one tile, so border vertices are evaluated once.
+    gsMatrix<> params(2, (i1 - i0) * (j1 - j0)), values;
+    index_t c = 0;
+    for(int64_t i = i0; i < i1; i++) {
+        for(int64_t j = j0; j < j1; j++, c++) {
+            params(0, c) = _gridLines[0][i];
+            params(1, c) = _gridLines[1][j];
+        }
+    }
+    _geometry.eval_into(params, values);
+
+    // Chunk layout: one file per band of tiles holding the band's grid rows as
+    // row-major xyz doubles, padded with zeros for planar geometries. Tiles of a
+    // band write their disjoint parts of every row through their own stream.
+    std::vector<double> buffer(3 * params.cols(), 0.0);
+    const index_t tarDim = std::min<index_t>(values.rows(), 3);
+    for(index_t k = 0; k < values.cols(); k++) {
+        for(index_t r = 0; r < tarDim; r++) {
+            buffer[3 * k + r] = values(r, k);
+        }
+    }
+    std::fstream chunkOut(ChunkName(prefix, a), std::ios::in | std::ios::out | std::ios::binary);
+    if(!chunkOut.is_open()) {
+        return false;
+    }
+    const int64_t width = j1 - j0;
+    for(int64_t i = i0; i < i1; i++) {
+        chunkOut.seekp(((i - i0) * _numNodes[1] + j0) * 3 * sizeof(double));
+        chunkOut.write(reinterpret_cast<const char *>(buffer.data() + 3 * (i - i0) * width), 3 * width * sizeof(double));
+    }
+    return static_cast<bool>(chunkOut);
+}
+
+bool TiledMeshBuilder::MergeChunks(const std::string &prefix, const std::string &filename)
+{
+    const std::string format = filename.substr(filename.find_last_of('.') + 1);
+    if(format != "off" && format != "obj" && format != "ply") {
+        _error = "Tiled mode only supports .off, .obj and .ply output";
+        return false;
+    }
+    std::ofstream fileOut(filename, std::ios::out);
+    if(!fileOut.is_open()) {
+        _error = "Failed to open file for writing: " + filename;
+        return false;
+    }
+    const bool withColor = _optionFlag & WITH_COLOR;
+    const int64_t numCells = (_numNodes[0] - 1) * (_numNodes[1] - 1);
+    const int64_t numVertices = _numNodes[0] * _numNodes[1];
+    const int64_t numFaces = _meshType == SQUARE_MESH ? numCells : 2 * numCells;
+
+    // Header, shared with the in-memory exporters.
+    if(format == "off") {
+        ExportUtils::WriteOffHeader(fileOut, numVertices, numFaces);
+    } else if(format == "ply") {
+        ExportUtils::WritePlyHeader(fileOut, "ascii", {}, numVertices, {"float x", "float y", "float z"}, numFaces, withColor);
+    } else if(withColor) {
+        ExportUtils::WriteObjHeader(fileOut, filename, numVertices, numFaces);
+        std::fstream fileMatOut(filename + ".mtl", std::ios::out);
+        if(!fileMatOut.is_open()) {
+            _error = "Failed to open material file for writing: " + filename + ".mtl";
+            return false;
+        }
+        ExportUtils::WriteMaterials(fileMatOut, {_color}, 1);
+    }
+
+    // Vertices: read the band chunks in order, one grid row at a time, so only
+    // one chunk is open and one grid row is in memory.
+    fileOut << std::fixed << std::setprecision(std::numeric_limits<long double>::digits10);
+    const char *vertexPrefix = format == "obj" ? "v " : "";
+    std::vector<double> row(3 * _numNodes[1]);
+    for(int64_t a = 0; a < _numTiles[0]; a++) {
+        std::ifstream chunk(ChunkName(prefix, a), std::ios::in | std::ios::binary);
+        if(!chunk.is_open()) {
+            _error = "Missing tile chunk: " + ChunkName(prefix, a);
+            return false;
+        }
+        const int64_t i1 = std::min((a + 1) * _tileSize, _numNodes[0]);
+        for(int64_t i = a * _tileSize; i < i1; i++) {
+            if(!chunk.read(reinterpret_cast<char *>(row.data()), row.size() * sizeof(double))) {
+                _error = "Truncated tile chunk: " + ChunkName(prefix, a);
+                return false;
+            }
+            for(int64_t j = 0; j < _numNodes[1]; j++) {
+                fileOut << vertexPrefix << row[3 * j] << " " << row[3 * j + 1] << " " << row[3 * j + 2] << '\n';
+            }
+        }
+    }
+    if(format == "obj" && withColor) {
+        fileOut << "\n\nusemtl material_0\n";
+    }
+
+    // Faces follow from index arithmetic on the grid, in the order SurfaceMeshStrategy uses.
+    const int64_t offset = format == "obj" ? 1 : 0; // OBJ format is 1-indexed
+    auto writeFace = [&](std::initializer_list<int64_t> ids) {
+        fileOut << (format == "obj" ? "f" : std::to_string(ids.size()));
+        for(int64_t id : ids) {
+            fileOut << " " << id + offset;
+        }
+        if(withColor && format != "obj") {
+            fileOut << " " << _color[0] << " " << _color[1] << " " << _color[2];
+        }
+        fileOut << '\n';
+    };
+    for(int64_t i = 0; i < _numNodes[0] - 1; i++) {
+        for(int64_t j = 0; j < _numNodes[1] - 1; j++) {
+            int64_t v1 = i * _numNodes[1] + j;
+            int64_t v2 = (i + 1) * _numNodes[1] + j;
+            int64_t v3 = i * _numNodes[1] + j + 1;
+            int64_t v4 = (i + 1) * _numNodes[1] + j + 1;
+            if(_optionFlag & INVERT_NORMAL) {
+                std::swap(v2, v3);
+            }
+            if(_meshType == SQUARE_MESH) {
+                writeFace({v1, v2, v4, v3});
+            } else {
+                writeFace({v1, v2, v3});
+                writeFace({v2, v4, v3});
+            }
+        }
+    }
+    if(format == "obj" && withColor) {
+        fileOut << '\n';
+    }
+    fileOut.close();
+    if(!fileOut) {
+        _error = "Failed to write file: " + filename;
+        return false;
+    }
+    return true;
+}
+
+void TiledMeshBuilder::RemoveChunks(const std::string &prefix) const
+{
+    for(int64_t a = 0; a < _numTiles[0]; a++) {
+        std::remove(ChunkName(prefix, a).c_str());
+    }
+}
+
+bool TiledMeshBuilder::BuildtoFile(const std::vector<std::string> &filenames, const std::vector<std::vector<real_t>> &gridLines)
+{
+    if(_geometry.parDim() != 2 || gridLines.size() < 2 || filenames.empty()) {
+        gsInfo << "Tiled mode only supports surface splines.\n";
+        return false;
+    }
+    _gridLines.assign(gridLines.begin(), gridLines.begin() + 2);
+    for(int d = 0; d < 2; d++) {
+        _numNodes[d] = _gridLines[d].size();
+        if(_numNodes[d] < 2) {
+            gsInfo << "Tiled mode needs at least one cell per direction.\n";
+            return false;
+        }
+    }
+
+    // Square tiles sized so that all tiles in flight fit in the memory budget.
+    // Use fewer threads when the budget does not hold a minimum tile per thread.
+    const size_t bytesPerVertex = BytesPerVertex();
+    const size_t minTileBytes = MIN_TILE_SIZE * MIN_TILE_SIZE * bytesPerVertex;
+    if(_memoryBudget < minTileBytes) {
+        gsInfo << "Memory budget too small for tiled mode, it needs at least "
+               << (minTileBytes + (1 << 20) - 1) / (1 << 20) << " MB.\n";
+        return false;
+    }
+    if(_memoryBudget < _numThreads * minTileBytes) {
+        _numThreads = static_cast<int>(_memoryBudget / minTileBytes);
+        gsInfo << "Memory budget only holds " << _numThreads << " tile" << (_numThreads == 1 ? "" : "s")
+               << " at a time, using as many threads.\n";
+    }
+    const size_t tileVertices = _memoryBudget / (_numThreads * bytesPerVertex);
+    _tileSize = std::max<int64_t>(MIN_TILE_SIZE, static_cast<int64_t>(std::sqrt(static_cast<double>(tileVertices))));
+    for(int d = 0; d < 2; d++) {
+        _numTiles[d] = (_numNodes[d] + _tileSize - 1) / _tileSize;
+    }
+    gsInfo << "Tiled tessellation: " << _numTiles[0] << " x " << _numTiles[1] << " tiles of "
+           << _tileSize << " x " << _tileSize << " vertices on " << _numThreads << " thread"
+           << (_numThreads == 1 ? "" : "s") << ".\n";
+
+    // Chunks are named after the first output file and live next to it.
+    const std::string &prefix = filenames[0];
+    for(int64_t a = 0; a < _numTiles[0]; a++) {
+        std::ofstream chunkOut(ChunkName(prefix, a), std::ios::out | std::ios::binary);
+        if(!chunkOut.is_open()) {
+            gsInfo << "Failed to create tile chunk " << ChunkName(prefix, a) << "\n";
+            RemoveChunks(prefix);
+            return false;
+        }
+    }
+    std::atomic<int64_t> nextTile(0);
+    std::atomic<bool> failed(false);
+    std::mutex errorMutex;
+    _error.clear();
+    auto worker = [&]() {
+        for(int64_t t = nextTile++; t < _numTiles[0] * _numTiles[1] && !failed; t = nextTile++) {
+            try {
+                if(!EvaluateTile(prefix, t / _numTiles[1], t % _numTiles[1])) {
+                    failed = true;
+                }
+            } catch(const std::exception &e) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                _error = std::string("Tile evaluation failed: ") + e.what();
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for(int t = 1; t < _numThreads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    if(failed) {
+        gsInfo << "Failed to write tile chunks for " << prefix << (_error.empty() ? "" : ": " + _error) << "\n";
+        RemoveChunks(prefix);
+        return false;
+    }
+
+    bool success = true;
+    for(const auto &filename : filenames) {
+        if(MergeChunks(prefix, filename)) {
+            gsInfo << "Mesh saved to file: " << filename << "\n";
+        } else {
+            gsInfo << "Failed to save mesh to file " << filename << ": " << _error << "\n";
+            success = false;
+        }
+    }
+    RemoveChunks(prefix);
+    return success;
+}
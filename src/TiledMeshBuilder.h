@@ -0,0 +1,48 @@
+#pragma once
+
+#include <gismo.h>
+#include "MeshStrategy.h"
+
+// Out-of-core tessellation of a surface spline. The parameter grid is split
+// into tiles that are evaluated independently and spilled to one temporary
+// binary chunk per band of tiles, which are merged into the output file in a
+// final sequential pass.
+class TiledMeshBuilder
+{
+private:
+    const gismo::gsGeometry<> &_geometry;
+    MeshType _meshType;
+    OptionFlag _optionFlag;
+    size_t _memoryBudget = size_t(256) << 20;
+    int _numThreads = 1;
+    std::array<index_t, 3> _color = {255, 0, 0};
+
+    // Grid nodes per direction and tile extent in nodes.
+    std::array<int64_t, 2> _numNodes = {0, 0};
+    int64_t _tileSize = 0;
+    std::array<int64_t, 2> _numTiles = {0, 0};
+    std::vector<std::vector<real_t>> _gridLines;
+    // Why the last chunk evaluation or merge failed.
+    std::string _error;
+
+    size_t BytesPerVertex() const;
+    std::string ChunkName(const std::string &prefix, int64_t a) const;
+    bool EvaluateTile(const std::string &prefix, int64_t a, int64_t b) const;
+    bool MergeChunks(const std::string &prefix, const std::string &filename);
+    void RemoveChunks(const std::string &prefix) const;
+
+public:
+    TiledMeshBuilder(const gismo::gsGeometry<> &geometry, MeshType meshType = TRIANGLE_MESH,
+                     OptionFlag optionFlag = static_cast<OptionFlag>(0))
+        : _geometry(geometry), _meshType(meshType), _optionFlag(optionFlag) {}
+
+    // Upper bound in bytes for the tiles being evaluated at the same time.
+    void SetMemoryBudget(size_t bytes) { _memoryBudget = bytes; }
+    // Number of tiles evaluated concurrently, 0 for the hardware concurrency.
+    void SetNumThreads(int numThreads);
+    void SetColor(const std::array<index_t, 3> &color) { _color = color; }
+
+    // Tessellate the tensor grid given by the parameter values in each direction
+    // and write it to every file.
+    bool BuildtoFile(const std::vector<std::string> &filenames, const std::vector<std::vector<real_t>> &gridLines);
+};
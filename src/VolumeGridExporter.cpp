@@ -0,0 +1,255 @@
+#include "VolumeGridExporter.h"
+#include "ExportUtils.h"
+#include <deque>
+#include <fstream>
+#include <future>
+
+namespace
+{
+    // Grid points evaluated per block.
+    const int64_t BLOCK_POINTS = int64_t(1) << 16;
+
+    template<class T>
+    void WriteRaw(std::ostream &out, const std::vector<T> &data)
+    {
+        out.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T));
+    }
+}
+
+void VolumeGridExporter::SetNumThreads(int numThreads)
+{
+    _numThreads = ExportUtils::NumThreads(numThreads);
+}
+
+template<class T>
+void VolumeGridExporter::EvaluateBlock(const gsVector<int> &numSample, int64_t p0, int64_t p1,
+                                       std::vector<T> &points, std::vector<T> &jacobians) const
+{
+    // VTK and XDMF structured grids run fastest along the first direction, so
+    // point p is node (p % nx, p / nx % ny, p / (nx * ny)).
+    const int64_t nx = numSample[0] + 1, ny = numSample[1] + 1;
+    gsMatrix<> params(3, p1 - p0), values, derivs;
+    for(int64_t p = p0; p < p1; p++) {
+        params(0, p - p0) = _gridLines[0][p % nx];
+        params(1, p - p0) = _gridLines[1][p / nx % ny];
+        params(2, p - p0) = _gridLines[2][p / (nx * ny)];
+    }
+    _geometry.eval_into(params, values);
+    // Columns of derivs hold (df1/du, df1/dv, df1/dw, df2/du, ...).
+    _geometry.deriv_into(params, derivs);
+
+    points.resize(3 * params.cols());
+    jacobians.resize(params.cols());
+    for(index_t p = 0; p < params.cols(); p++) {
+        for(int r = 0; r < 3; r++) {
+            points[3 * p + r] = static_cast<T>(values(r, p));
+        }
+        auto d = [&](int r, int s) { return derivs(3 * r + s, p); };
+        jacobians[p] = static_cast<T>(d(0, 0) * (d(1, 1) * d(2, 2) - d(1, 2) * d(2, 1))
+                                    - d(0, 1) * (d(1, 0) * d(2, 2) - d(1, 2) * d(2, 0))
+                                    + d(0, 2) * (d(1, 0) * d(2, 1) - d(1, 1) * d(2, 0)));
+    }
+}
+
+template<class T>
+bool VolumeGridExporter::Export(const std::vector<std::string> &filenames, const std::vector<std::string> &formats,
+                                const gsVector<int> &numSample)
+{
+    const int64_t numLayers = numSample[2] + 1;
+    const int64_t layer = int64_t(numSample[0] + 1) * (numSample[1] + 1);
+    const int64_t numPoints = layer * numLayers;
+    const uint64_t pointBytes = 3 * numPoints * sizeof(T), jacobianBytes = numPoints * sizeof(T);
+    const bool littleEndian = ExportUtils::IsLittleEndian();
+    const std::string vtkType = sizeof(T) == 4 ? "Float32" : "Float64";
+
+    // Binary data goes to the .vts file itself or to a .raw file next to the .xmf.
+    // Targets that failed already have an error and stay closed.
+    std::vector<std::string> rawnames(filenames.size());
+    std::vector<std::fstream> dataOut(filenames.size());
+    std::vector<std::streamoff> pointsPos(filenames.size(), 0), jacobiansPos(filenames.size(), pointBytes);
+    size_t numOpen = 0;
+    for(size_t i = 0; i < filenames.size(); i++) {
+        if(!_errors[i].empty()) {
+            continue;
+        }
+        const std::string &filename = filenames[i];
+        rawnames[i] = formats[i] == "vts" ? filename : filename.substr(0, filename.find_last_of('.')) + ".raw";
+        std::fstream &out = dataOut[i];
+        out.open(rawnames[i], std::ios::out | std::ios::binary);
+        if(!out.is_open()) {
+            _errors[i] = "Failed to open file for writing: " + rawnames[i];
+            continue;
+        }
+        numOpen++;
+        if(formats[i] != "vts") {
+            continue;
+        }
+        out << "<?xml version=\"1.0\"?>\n";
+        out << "<VTKFile type=\"StructuredGrid\" version=\"1.0\" byte_order=\""
+            << (littleEndian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">\n";
+        const std::string extent = "0 " + std::to_string(numSample[0]) + " 0 " + std::to_string(numSample[1])
+                                 + " 0 " + std::to_string(numSample[2]);
+        out << "  <StructuredGrid WholeExtent=\"" << extent << "\">\n";
+        out << "    <Piece Extent=\"" << extent << "\">\n";
+        out << "      <PointData Scalars=\"JacobianDeterminant\">\n";
+        out << "        <DataArray type=\"" << vtkType << "\" Name=\"JacobianDeterminant\" format=\"appended\" offset=\""
+            << sizeof(uint64_t) + pointBytes << "\"/>\n";
+        out << "      </PointData>\n";
+        out << "      <Points>\n";
+        out << "        <DataArray type=\"" << vtkType << "\" NumberOfComponents=\"3\" format=\"appended\" offset=\"0\"/>\n";
+        out << "      </Points>\n";
+        out << "    </Piece>\n";
+        out << "  </StructuredGrid>\n";
+        out << "  <AppendedData encoding=\"raw\">\n   _";
+        // Each appended array is preceded by its size in bytes.
+        const std::streamoff base = out.tellp();
+        out.write(reinterpret_cast<const char *>(&pointBytes), sizeof(uint64_t));
+        out.seekp(base + sizeof(uint64_t) + pointBytes);
+        out.write(reinterpret_cast<const char *>(&jacobianBytes), sizeof(uint64_t));
+        pointsPos[i] = base + sizeof(uint64_t);
+        jacobiansPos[i] = base + 2 * sizeof(uint64_t) + pointBytes;
+    }
+    if(numOpen == 0) {
+        return false;
+    }
+
+    // Evaluate blocks of consecutive grid points in parallel, at most two blocks
+    // per thread in flight, and write each block into both arrays of every open
+    // target once it is its turn, so the grid is evaluated once for all targets.
+    using Block = std::pair<std::vector<T>, std::vector<T>>;
+    std::deque<std::future<Block>> pending;
+    int64_t next = 0, written = 0;
+    T minJacobian = std::numeric_limits<T>::max(), maxJacobian = std::numeric_limits<T>::lowest();
+    int64_t numFolded = 0;
+    while(numOpen > 0 && (next < numPoints || !pending.empty())) {
+        while(next < numPoints && pending.size() < 2 * static_cast<size_t>(_numThreads)) {
+            const int64_t p0 = next, p1 = std::min(next + BLOCK_POINTS, numPoints);
+            pending.push_back(std::async(std::launch::async, [this, &numSample, p0, p1]() {
+                Block block;
+                EvaluateBlock<T>(numSample, p0, p1, block.first, block.second);
+                return block;
+            }));
+            next = p1;
+        }
+        const Block block = pending.front().get();
+        pending.pop_front();
+        for(size_t i = 0; i < filenames.size(); i++) {
+            std::fstream &out = dataOut[i];
+            if(!out.is_open()) {
+                continue;
+            }
+            out.seekp(pointsPos[i] + 3 * written * sizeof(T));
+            WriteRaw(out, block.first);
+            out.seekp(jacobiansPos[i] + written * sizeof(T));
+            WriteRaw(out, block.second);
+            if(!out) {
+                _errors[i] = "Failed to write file: " + rawnames[i];
+                out.close();
+                numOpen--;
+            }
+        }
+        for(T jacobian : block.second) {
+            minJacobian = std::min(minJacobian, jacobian);
+            maxJacobian = std::max(maxJacobian, jacobian);
+            numFolded += jacobian <= 0;
+        }
+        written += block.second.size();
+    }
+    if(numOpen == 0) {
+        return false;
+    }
+
+    bool success = true;
+    for(size_t i = 0; i < filenames.size(); i++) {
+        std::fstream &out = dataOut[i];
+        if(!out.is_open()) {
+            success = false;
+            continue;
+        }
+        if(formats[i] == "vts") {
+            out.seekp(jacobiansPos[i] + jacobianBytes);
+            out << "\n  </AppendedData>\n</VTKFile>\n";
+        }
+        out.close();
+        if(!out) {
+            _errors[i] = "Failed to write file: " + rawnames[i];
+            success = false;
+            continue;
+        }
+        if(formats[i] != "xmf") {
+            continue;
+        }
+
+        const std::string &filename = filenames[i];
+        std::fstream fileOut(filename, std::ios::out);
+        if(!fileOut.is_open()) {
+            _errors[i] = "Failed to open file for writing: " + filename;
+            success = false;
+            continue;
+        }
+        const std::string rawRef = rawnames[i].substr(rawnames[i].find_last_of("/\\") + 1);
+        const std::string dataItem = std::string("NumberType=\"Float\" Precision=\"") + std::to_string(sizeof(T))
+                                   + "\" Format=\"Binary\" Endian=\"" + (littleEndian ? "Little" : "Big") + "\"";
+        fileOut << "<?xml version=\"1.0\" ?>\n";
+        fileOut << "<Xdmf Version=\"3.0\">\n";
+        fileOut << "  <Domain>\n";
+        fileOut << "    <Grid Name=\"volume\" GridType=\"Uniform\">\n";
+        fileOut << "      <Topology TopologyType=\"3DSMesh\" Dimensions=\"" << numSample[2] + 1 << " "
+                << numSample[1] + 1 << " " << numSample[0] + 1 << "\"/>\n";
+        fileOut << "      <Geometry GeometryType=\"XYZ\">\n";
+        fileOut << "        <DataItem Dimensions=\"" << numPoints << " 3\" " << dataItem << " Seek=\"0\">"
+                << rawRef << "</DataItem>\n";
+        fileOut << "      </Geometry>\n";
+        fileOut << "      <Attribute Name=\"JacobianDeterminant\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+        fileOut << "        <DataItem Dimensions=\"" << numPoints << "\" " << dataItem << " Seek=\"" << pointBytes << "\">"
+                << rawRef << "</DataItem>\n";
+        fileOut << "      </Attribute>\n";
+        fileOut << "    </Grid>\n";
+        fileOut << "  </Domain>\n";
+        fileOut << "</Xdmf>\n";
+        fileOut.close();
+        if(!fileOut) {
+            _errors[i] = "Failed to write file: " + filename;
+            success = false;
+        }
+    }
+
+    gsInfo << "Jacobian determinant in [" << minJacobian << ", " << maxJacobian << "]";
+    if(numFolded > 0) {
+        gsInfo << ", " << numFolded << " of " << numPoints << " samples are not positive";
+    }
+    gsInfo << ".\n";
+    return success;
+}
+
+bool VolumeGridExporter::ExportGrid(const std::vector<std::string> &filenames, const std::vector<std::vector<real_t>> &gridLines)
+{
+    _errors.assign(filenames.size(), "");
+    if(_geometry.parDim() != 3 || _geometry.geoDim() != 3 || gridLines.size() < 3) {
+        _errors.assign(filenames.size(), "Volume grid output needs a trivariate spline in 3D.");
+        return false;
+    }
+    _gridLines.assign(gridLines.begin(), gridLines.begin() + 3);
+    gsVector<int> numSample(3);
+    for(int d = 0; d < 3; d++) {
+        if(_gridLines[d].size() < 2) {
+            _errors.assign(filenames.size(), "Volume grid output needs at least one cell per direction.");
+            return false;
+        }
+        numSample[d] = static_cast<int>(_gridLines[d].size()) - 1;
+    }
+    std::vector<std::string> formats(filenames.size());
+    for(size_t i = 0; i < filenames.size(); i++) {
+        formats[i] = filenames[i].substr(filenames[i].find_last_of('.') + 1);
+        if(formats[i] == "xdmf") {
+            formats[i] = "xmf";
+        }
+        if(formats[i] != "vts" && formats[i] != "xmf") {
+            _errors[i] = "Unsupported volume grid format: " + formats[i] + ". Please use .vts or .xmf.";
+        }
+    }
+    if(_optionFlag & SINGLE_PRECISION) {
+        return Export<float>(filenames, formats, numSample);
+    }
+    return Export<real_t>(filenames, formats, numSample);
+}
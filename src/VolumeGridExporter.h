@@ -0,0 +1,42 @@
+#pragma once
+
+#include <gismo.h>
+#include "MeshStrategy.h"
+
+// Samples the full parameter grid of a volume spline and streams it as a
+// structured grid with the Jacobian determinant as point data, as binary VTK
+// (.vts, appended raw data) and/or as XDMF (.xmf) with a .raw file.
+// Blocks of at most 64k consecutive grid points are evaluated in parallel and
+// written in order to every target, so memory stays bounded whatever the grid
+// size and the grid is evaluated once however many files are written.
+class VolumeGridExporter
+{
+private:
+    const gismo::gsGeometry<> &_geometry;
+    OptionFlag _optionFlag;
+    int _numThreads = 1;
+    std::vector<std::vector<real_t>> _gridLines;
+    std::vector<std::string> _errors;
+
+    template<class T>
+    bool Export(const std::vector<std::string> &filenames, const std::vector<std::string> &formats,
+                const gsVector<int> &numSample);
+    template<class T>
+    void EvaluateBlock(const gsVector<int> &numSample, int64_t p0, int64_t p1,
+                       std::vector<T> &points, std::vector<T> &jacobians) const;
+
+public:
+    VolumeGridExporter(const gismo::gsGeometry<> &geometry, OptionFlag optionFlag = static_cast<OptionFlag>(0))
+        : _geometry(geometry), _optionFlag(optionFlag) {}
+
+    // Number of blocks evaluated concurrently, 0 for the hardware concurrency.
+    void SetNumThreads(int numThreads);
+
+    // Sample the tensor grid given by the parameter values in each direction
+    // and write it to every file. Returns false if any file failed.
+    bool ExportGrid(const std::vector<std::string> &filenames, const std::vector<std::vector<real_t>> &gridLines);
+    // Why the i-th file of the last ExportGrid call failed, empty if it was written.
+    const std::string &GetError(size_t i) const {
+        return _errors[i];
+    }
+};
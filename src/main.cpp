@@ -3,21 +3,42 @@
 
 int main(int argc, char *argv[])
 {
-    std::string outputfile("output.off"), inputfile("");
+    std::string inputfile("");
+    std::vector<std::string> outputfiles;
     index_t numSample = 64;
     bool withColor = false;
     bool invertNormal = false;
     bool squareMesh = false;
     bool showFormat = false;
+    bool binary = false;
+    bool quantize = false;
+    bool optimize = false;
+    bool meshlets = false;
+    bool singlePrecision = false;
+    bool volumeGrid = false;
+    index_t memoryBudget = 0;
+    index_t numThreads = 0;
+    real_t edgeLength = 0;
+    real_t chordTolerance = 0;
 
     gsCmdLine cmd("Give me a file (eg: .xml) with Spline and I will try to convert it to mesh!");
 
     cmd.addPlainString("filename", "File containing spline to convert (.xml)", inputfile);
-    cmd.addString("o", "oname", "Output file name", outputfile);
+    cmd.addMultiString("o", "oname", "Output file name, repeat to export several formats", outputfiles);
     cmd.addInt("n", "num", "Number of samples to use for building the model", numSample);
+    cmd.addInt("m", "memory", "Memory budget in MB for tiled out-of-core tessellation of surfaces (0 disables tiling)", memoryBudget);
+    cmd.addReal("e", "edge", "Target edge length, chooses the samples per knot span from the control net instead of -n", edgeLength);
+    cmd.addReal("c", "tol", "Chord tolerance, chooses the samples per knot span from the control net instead of -n", chordTolerance);
+    cmd.addInt("t", "threads", "Number of threads for tiled tessellation, volume grids and writing output (0 uses all cores)", numThreads);
     cmd.addSwitch("color", "Use color for the model", withColor);
     cmd.addSwitch("invert", "Invert the color of the model", invertNormal);
     cmd.addSwitch("square", "Use square mesh instead of triangle mesh", squareMesh);
+    cmd.addSwitch("binary", "Write binary output where the format supports it (.ply)", binary);
+    cmd.addSwitch("quantize", "Quantize binary positions to 16 bits and normals to octahedral 16-bit pairs", quantize);
+    cmd.addSwitch("optimize", "Reorder triangles and vertices for GPU vertex cache locality", optimize);
+    cmd.addSwitch("meshlets", "Also write meshlets of the final triangle order to <OUTPUT>.meshlets", meshlets);
+    cmd.addSwitch("float", "Build and export the mesh in single precision", singlePrecision);
+    cmd.addSwitch("volume", "Sample the interior of a volume spline to a structured grid (.vts or .xmf)", volumeGrid);
     cmd.addSwitch("showFormat", "Show supported export formats", showFormat);
 
     try { cmd.getValues(argc,argv); } catch (int rv) { return rv; }
@@ -35,9 +56,35 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if ( outputfiles.empty() )
+    {
+        outputfiles.push_back(volumeGrid ? "output.vts" : "output.off");
+    }
+
+    if((optimize || meshlets) && (squareMesh || memoryBudget > 0 || volumeGrid)) {
+        gsInfo << "--optimize and --meshlets need an in-memory triangle mesh and cannot be combined with --square, -m or --volume.\n";
+        return EXIT_FAILURE;
+    }
+    if((binary || quantize || singlePrecision) && memoryBudget > 0) {
+        gsInfo << "Tiled mode (-m) writes ASCII text in double precision and cannot be combined with --binary, --quantize or --float.\n";
+        return EXIT_FAILURE;
+    }
+
+#ifndef SINGLE_PRECISION_USE
+    if(singlePrecision && !volumeGrid) {
+        gsInfo << "gismo was built without float instances, --float only applies to --volume. Using double precision.\n";
+        singlePrecision = false;
+    }
+#endif
+
     OptionFlag optionFlag = static_cast<OptionFlag>(0);
     optionFlag = withColor ? static_cast<OptionFlag>(optionFlag | WITH_COLOR) : optionFlag;
     optionFlag = invertNormal ? static_cast<OptionFlag>(optionFlag | INVERT_NORMAL) : optionFlag;
+    optionFlag = binary ? static_cast<OptionFlag>(optionFlag | BINARY_OUTPUT) : optionFlag;
+    optionFlag = quantize ? static_cast<OptionFlag>(optionFlag | BINARY_OUTPUT | QUANTIZE) : optionFlag;
+    optionFlag = optimize ? static_cast<OptionFlag>(optionFlag | OPTIMIZE_VERTEX_CACHE) : optionFlag;
+    optionFlag = meshlets ? static_cast<OptionFlag>(optionFlag | EMIT_MESHLETS) : optionFlag;
+    optionFlag = singlePrecision ? static_cast<OptionFlag>(optionFlag | SINGLE_PRECISION) : optionFlag;
     MeshType meshType = squareMesh ? SQUARE_MESH : TRIANGLE_MESH;
     BasisSplineProcess basisSplineProcess(optionFlag, meshType);
     if(!basisSplineProcess.LoadSplinefromFile(inputfile)) {
@@ -55,7 +102,22 @@ int main(int argc, char *argv[])
     }
     gsInfo << "Spline dimension: " << splineProcessPtr->GetDimension() << "\n";
     splineProcessPtr->InitializeMeshStrategy();
-    if(!splineProcessPtr->BuildSurfacetoFile(outputfile, numSample)){
+    splineProcessPtr->SetNumThreads(numThreads);
+    // In-memory meshes number vertices and faces with index_t, a triangle mesh has
+    // about twice as many faces as vertices. Tiled and volume grid output count in 64 bit.
+    const int64_t maxVertices = (volumeGrid || memoryBudget > 0) ? 0 : std::numeric_limits<index_t>::max() / 2;
+    if((edgeLength > 0 || chordTolerance > 0) && !splineProcessPtr->SetAutoResolution(edgeLength, chordTolerance, maxVertices)) {
+        return EXIT_FAILURE;
+    }
+    if(volumeGrid) {
+        if(!splineProcessPtr->BuildVolumetoFile(outputfiles, numSample, numThreads)){
+            return EXIT_FAILURE;
+        }
+    } else if(memoryBudget > 0) {
+        if(!splineProcessPtr->BuildSurfacetoFileTiled(outputfiles, numSample, static_cast<size_t>(memoryBudget) << 20, numThreads)){
+            return EXIT_FAILURE;
+        }
+    } else if(!splineProcessPtr->BuildSurfacetoFile(outputfiles, numSample)){
         return EXIT_FAILURE;
     }
 